@@ -0,0 +1,36 @@
+/*
+Aggregate.cpp
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Experiment.h"
+#include "CommandLine.h"
+#include "Aggregate.h"
+
+// Merges the summaries of several monitoring nodes, one process each, into exact global heaviest hitters
+// and reports the merge throughput for each number of nodes. For example:
+//   HL-Hitters-Aggregate -N 1,2,4,8,16 -f 10000 -q 5000 -k 10 -v 1
+int main(int argc, char **argv){
+
+    AggregateParams ap = readAggregateParams(argc, argv);  // Get the aggregation params from the command line
+    AggregateRunner runner(ap);
+    bool ok = runner.Run();  // Run the benchmark
+
+    return ok ? 0 : 1;
+}
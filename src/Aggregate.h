@@ -0,0 +1,234 @@
+/*
+Aggregate.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AGGREGATE_H_
+#define AGGREGATE_H_
+
+#include "Common.h"
+#include "Experiment.h"
+#include "Summary.h"
+#include "Timer.h"
+
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>  // For fork(), read(), write()
+#include <sys/socket.h>  // For socketpair()
+#include <sys/wait.h>  // For waitpid()
+#include <sys/prctl.h>  // For prctl()
+
+// The parameters of a multi-node aggregation benchmark
+struct AggregateParams{
+    Experiment::Params params;  // The experiment each node runs, node i uses random seed params.random_seed + i
+    std::vector<uint> node_counts;  // The numbers of nodes to benchmark
+    uint times;  // The number of timed merges for each number of nodes
+};
+
+// Benchmarks merging the summaries of several monitoring nodes into exact global heaviest hitters.
+// Each node is a forked process which runs an experiment up to its steady state (with a full queue)
+// and sends the summary of its algorithm over a UNIX socket. The parent times merging all summaries and querying the global top-k.
+class AggregateRunner {
+    AggregateParams ap;  // The benchmark parameters
+
+public:
+    // The nodes must generate their packets: the flow ids of a replayed trace depend on each node's discovery order,
+    // so summing the summaries by id would merge unrelated flows
+    AggregateRunner(const AggregateParams & ap)
+    :ap(ap)
+    {
+        if(!ap.params.trace_file.empty()){
+            std::cout << "Error: The summaries of replayed traces cannot be aggregated, their flow ids are not global" << std::endl;
+            ::exit(-1);
+        }
+    }
+
+    // Runs the benchmark for every number of nodes. Returns false if a node failed or validation failed.
+    bool Run(){
+        foreach(uint nodes, ap.node_counts)
+            if(!RunNodes(nodes))
+                return false;
+        return true;
+    }
+
+protected:
+    // Runs the benchmark for one number of nodes
+    bool RunNodes(uint nodes){
+        // Start the nodes and collect their summaries
+        std::vector<std::vector<char> > summaries(nodes);
+        std::vector<pid_t> pids;
+        std::vector<int> fds;
+        for(uint i=0; i<nodes; ++i){
+            int sv[2];
+            if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0){
+                std::cout << "Error: Cannot create socket pair" << std::endl;
+                ::exit(-1);
+            }
+            std::cout.flush();
+            pid_t pid = fork();
+            if(pid < 0){
+                std::cout << "Error: Cannot fork node" << std::endl;
+                ::exit(-1);
+            }
+            if(pid == 0){
+                close(sv[0]);
+                foreach(int fd, fds) close(fd);
+                prctl(PR_SET_PDEATHSIG, SIGTERM);  // Do not outlive the aggregator
+                RunNode(i, sv[1]);
+                _exit(0);
+            }
+            close(sv[1]);
+            pids.push_back(pid);
+            fds.push_back(sv[0]);
+        }
+        bool ok = true;
+        for(uint i=0; i<nodes; ++i){
+            ok = ReceiveSummary(fds[i], summaries[i]) && ok;
+            close(fds[i]);
+            int status;
+            while(waitpid(pids[i], &status, 0) < 0 && errno == EINTR) {}
+            ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        if(!ok){
+            std::cout << "Failed: " << nodes << " nodes, a node did not send its summary" << std::endl;
+            return false;
+        }
+
+        // Time merging the summaries and querying the global top-k
+        SummaryAggregator aggregator;
+        std::vector<SummaryAggregator::FlowTotal> top;
+        MultiShotTimer timer;
+        uint64_t entries = 0;
+        for(uint t=0; t<ap.times; ++t){
+            aggregator.Clear();
+            entries = 0;
+            timer.Start();
+            foreach(const std::vector<char> & s, summaries){
+                SummaryView view(&s[0], s.size());
+                aggregator.Merge(view);
+                entries += view.Size();
+            }
+            aggregator.QueryHeaviest(ap.params.k_heaviest, top);
+            timer.Stop();
+        }
+
+        if(ap.params.validation && !Validate(nodes, top))
+            return false;
+
+        std::cout << "Nodes:" << nodes << ", Entries:" << entries << ", GlobalFlows:" << aggregator.FlowCount()
+                  << ", GlobalPackets:" << aggregator.TotalCount() << ", Top:";
+        foreach(SummaryAggregator::FlowTotal & ft, top)
+            std::cout << "F" << ft.first << "=" << ft.second << " ";
+        std::cout << ", Merge Time Statistics: " << timer
+                  << ", MergedEntriesPerSec:" << ((timer.Mean() > 0) ? entries / timer.Mean() : 0.0) << std::endl;
+        return true;
+    }
+
+    // Returns the experiment parameters of node i
+    Experiment::Params NodeParams(uint i){
+        Experiment::Params p = ap.params;
+        p.number = i + 1;
+        p.random_seed = ap.params.random_seed + i;
+        p.validation = false;
+        p.oplog_file.clear();
+        return p;
+    }
+
+    // The body of node i: runs its experiment up to the steady state and sends the summary of its algorithm to fd
+    void RunNode(uint i, int fd){
+        std::vector<char> buffer;
+        {
+            Experiment exp(NodeParams(i));
+            exp.Fill();
+            exp.Steady();
+            SerializeSummary(*exp.GetCurrentAlgorithm(), i, buffer);
+        }
+        uint64_t size = buffer.size();
+        if(!WriteAll(fd, &size, sizeof(size)) || !WriteAll(fd, &buffer[0], buffer.size()))
+            _exit(1);
+        close(fd);
+    }
+
+    // Receives one length prefixed summary from fd
+    bool ReceiveSummary(int fd, std::vector<char> & buffer){
+        uint64_t size;
+        if(!ReadAll(fd, &size, sizeof(size)))
+            return false;
+        buffer.resize(size);
+        if(size == 0 || !ReadAll(fd, &buffer[0], size))
+            return false;
+        return SummaryView(&buffer[0], size).Valid();
+    }
+
+    // Checks the global top-k against the global counts of BruteForce runs of the same node experiments
+    bool Validate(uint nodes, std::vector<SummaryAggregator::FlowTotal> & top){
+        SummaryAggregator::FlowTotalMap expected;
+        for(uint i=0; i<nodes; ++i){
+            Experiment::Params p = NodeParams(i);
+            p.alg_type = Experiment::BRUTEFORCE;
+            p.query_mode = Experiment::QUERY_NONE;
+            p.notify = false;
+            Experiment exp(p);
+            exp.Fill();
+            exp.Steady();
+            std::vector<char> buffer;
+            SerializeSummary(*exp.GetCurrentAlgorithm(), i, buffer);
+            foreach(const SummaryEntry & e, SummaryView(&buffer[0], buffer.size()))
+                expected[e.flow_id] += e.count;
+        }
+
+        std::vector<uint64_t> expected_counts;  // The expected global counts, heaviest first
+        for(SummaryAggregator::FlowTotalMap::iterator it = expected.begin(); it != expected.end(); ++it)
+            expected_counts.push_back(it->second);
+        std::sort(expected_counts.rbegin(), expected_counts.rend());
+
+        bool valid = (top.size() == std::min(expected_counts.size(), (std::size_t)ap.params.k_heaviest));
+        for(uint i=0; valid && i<top.size(); ++i)  // Each flow has its expected count, and the counts are the heaviest
+            valid = (expected[top[i].first] == top[i].second) && (top[i].second == expected_counts[i]);
+        if(!valid)
+            std::cout << "With " << nodes << " nodes validation of the global top-k failed!" << std::endl;
+        return valid;
+    }
+
+    static bool WriteAll(int fd, const void * buf, std::size_t len){
+        const char * p = (const char *)buf;
+        while(len > 0){
+            ssize_t n = write(fd, p, len);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return false;
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    static bool ReadAll(int fd, void * buf, std::size_t len){
+        char * p = (char *)buf;
+        while(len > 0){
+            ssize_t n = read(fd, p, len);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return false;
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+};
+
+#endif /* AGGREGATE_H_ */
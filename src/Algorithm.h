@@ -26,21 +26,94 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 #include "Common.h"
 #include "Network.h"
 
+#include <cmath>
+
 // Interface Class of a Heaviest Hitters algorithm
 class Algorithm {
 public:
     virtual void QueryHeaviest(uint k, HittersQueryResult & result) = 0;  // Calculates and returns the k Heaviest Hitters in the provided result container
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results) = 0;  // Writes the flows with a count of at least c, heaviest first, into result (at most max_results) and returns their number
+    virtual uint TotalCount() = 0;  // Returns the number of packets currently counted
+    virtual uint GetCount(FlowP flowp) = 0;  // Returns the count of a flow, 0 if it is not counted
+    virtual uint Rank(FlowP flowp) = 0;  // Returns 1 + the number of flows with a greater count than flowp, 0 if it is not counted
+    virtual void QueryHistogram(FlowSizeHistogram & result) = 0;  // Returns the number of flows at each count in the provided result container
+    virtual uint DistinctCounts() = 0;  // Returns the number of distinct counts among the flows
+    virtual uint FlowSizeQuantile(double q) = 0;  // Returns the count of the flow at position ceil(q*flows) in increasing count order (the first for q=0), 0 if no flows are counted
+    virtual double FlowSizeEntropy() = 0;  // Returns the Shannon entropy in bits of the distribution of the counted packets over the flows
     virtual void Append(Packet& packet) = 0;  // Executed when a new item is received
     virtual void Expire(Packet& packet) = 0;  // Executed when an item is served
+    virtual AllocationStats MemoryStats() = 0;  // Returns the memory usage of the algorithm's data structure (all zero unless tracking was enabled)
     virtual ~Algorithm() {}  // Does nothing but is required for safe destruction
+
+    // Returns the position, from 1, of the q quantile among n items in increasing order
+    static uint QuantilePosition(double q, uint n){
+        uint pos = (uint)std::ceil(q * n);
+        return (pos < 1) ? 1 : (pos > n) ? n : pos;
+    }
+
+    // Returns the entropy term in bits of `flows` flows with `count` packets each, out of `total` packets
+    static double EntropyTerm(uint count, uint flows, uint total){
+        double p = (double)count / total;
+        return -(double)flows * p * std::log(p) / std::log(2.0);
+    }
+
+    // Returns true if fewer than k flows have a greater count than flowp, i.e. its rank is at most k (ties share a rank)
+    virtual bool IsInTopK(FlowP flowp, uint k){
+        uint rank = Rank(flowp);
+        return rank > 0 && rank <= k;
+    }
+
+    // Returns true if the counts are exact, false if they are estimates
+    virtual bool IsExact(){
+        return true;
+    }
+
+    // Rebuilds the state of an empty algorithm from n flows and their counts, heaviest first (as QueryAboveCount writes them).
+    // Returns false if the algorithm cannot be restored or the flows are inconsistent.
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        return false;
+    }
+
+    // Changes the maximum number of packets counted at once, the queue size, once the packets beyond it are expired.
+    // Returns false if the algorithm counts more packets than the new size. The algorithms unbounded by the queue size ignore it.
+    virtual bool Resize(uint max_queue_size){
+        return true;
+    }
+
+    // Empties the algorithm, as if it had just been constructed, keeping its storage for reuse.
+    // Returns false if the algorithm cannot be reset, then it must be constructed anew.
+    virtual bool Reset(){
+        return false;
+    }
+
+    // Returns the median flow count
+    uint FlowSizeMedian(){
+        return FlowSizeQuantile(0.5);
+    }
+
+    // Writes the flows holding more than a phi fraction of the counted packets, heaviest first, into result (at most max_results) and returns their number
+    uint QueryAboveFraction(double phi, FlowCountPair * result, uint max_results){
+        return QueryAboveCount((uint)(phi * TotalCount()) + 1, result, max_results);
+    }
 };
 
 // An Algorithm class that implements the Algorithm interface but does no processing
 class NoProcessingAlgorithm: public Algorithm {
 public:
     virtual void QueryHeaviest(uint k, HittersQueryResult & result) {}  // Do nothing
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results) { return 0; }  // Do nothing
+    virtual uint TotalCount() { return 0; }  // Counts nothing
+    virtual uint GetCount(FlowP flowp) { return 0; }  // Counts nothing
+    virtual uint Rank(FlowP flowp) { return 0; }  // Ranks nothing
+    virtual void QueryHistogram(FlowSizeHistogram & result) {}  // Do nothing
+    virtual uint DistinctCounts() { return 0; }  // Counts nothing
+    virtual uint FlowSizeQuantile(double q) { return 0; }  // Counts nothing
+    virtual double FlowSizeEntropy() { return 0.0; }  // Counts nothing
     virtual void Append(Packet& packet) {}  // Do nothing
     virtual void Expire(Packet& packet) {}  // Do nothing
+    virtual AllocationStats MemoryStats() { return AllocationStats(); }  // Uses no memory
+    virtual bool Restore(const FlowCountPair * flows, uint n) { return true; }  // Counts nothing
+    virtual bool Reset() { return true; }  // Counts nothing
 };
 
 
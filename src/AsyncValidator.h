@@ -0,0 +1,322 @@
+/*
+AsyncValidator.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASYNCVALIDATOR_H_
+#define ASYNCVALIDATOR_H_
+
+#include "Common.h"
+#include "Network.h"
+#include "Algorithm.h"
+#include "BruteForceAlgorithm.h"
+
+#include <boost/thread.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
+// The observed accuracy of an approximate algorithm's top-k, measured against the exact counts at every validation
+struct AccuracyStats{
+    uint64_t queries;  // The number of validated top-k queries
+    double precision_sum;  // The sum of the fractions of the reported flows which are in the exact top-k
+    double recall_sum;  // The sum of the fractions of the exact top-k which is reported
+    uint64_t reported;  // The number of reported flows
+    uint64_t count_error_sum;  // The sum of the absolute count errors of the reported flows
+    uint max_count_error;  // The maximum absolute count error of a reported flow
+
+    AccuracyStats()
+    :queries(0), precision_sum(0.0), recall_sum(0.0), reported(0), count_error_sum(0), max_count_error(0) {}
+
+    double Precision() const { return queries ? precision_sum / queries : 1.0; }
+    double Recall() const { return queries ? recall_sum / queries : 1.0; }
+    double MeanCountError() const { return reported ? (double)count_error_sum / reported : 0.0; }
+
+    // Records the precision and recall of a reported top-k and the count errors of its flows against the exact counts.
+    // A reported flow is correct if its exact rank is at most k, so any flow tied with the k-th is accepted.
+    void Record(const HittersQueryResult & topk, BruteForceAlgorithm & exact, uint k){
+        uint correct = 0;
+        foreach(const FlowCountPair & fc, topk){
+            uint count = exact.GetCount(fc.first);
+            if(exact.IsInTopK(fc.first, k))
+                correct++;
+            uint error = (fc.second > count) ? fc.second - count : count - fc.second;
+            count_error_sum += error;
+            max_count_error = std::max(max_count_error, error);
+        }
+        uint expected = std::min(k, (uint)exact.flow_count_dict.size());
+        queries++;
+        reported += topk.size();
+        precision_sum += topk.empty() ? 1.0 : (double)correct / topk.size();
+        recall_sum += (expected == 0) ? 1.0 : std::min(1.0, (double)correct / expected);
+    }
+
+    // Adds the measurements of another validator
+    AccuracyStats & operator+= (const AccuracyStats & a){
+        queries += a.queries;
+        precision_sum += a.precision_sum;
+        recall_sum += a.recall_sum;
+        reported += a.reported;
+        count_error_sum += a.count_error_sum;
+        max_count_error = std::max(max_count_error, a.max_count_error);
+        return *this;
+    }
+};
+
+// Helper function for printing
+std::ostream& operator<< (std::ostream &out, const AccuracyStats &a){
+    out << "Queries:" << a.queries << ", Precision:" << a.Precision() << ", Recall:" << a.Recall()
+        << ", MeanCountError:" << a.MeanCountError() << ", MaxCountError:" << a.max_count_error;
+    return out;
+}
+
+
+// An operation of the validated algorithm, with a snapshot of its answers when the step is sampled
+struct ValidationOp{
+    // APPEND/EXPIRE update the validating BruteForce, STOP ends the validation thread
+    enum Type {APPEND, EXPIRE, STOP};
+
+    Type type;
+    FlowP flowp;  // The flow of the appended or expired packet
+    uint iteration;  // The experiment's iteration, to report mismatches with
+    bool sampled;  // Whether the snapshot below is to be validated
+    uint results;  // The number of top-k results which follow on the results ring
+    uint count;  // The algorithm's count of flowp
+    bool in_topk;  // Whether the algorithm has flowp in the top-k
+    uint total;  // The algorithm's total count
+
+    ValidationOp() {}
+    ValidationOp(Type type, FlowP flowp, uint iteration)
+    :type(type), flowp(flowp), iteration(iteration), sampled(false), results(0), count(0), in_topk(false), total(0) {}
+};
+
+// Validates an algorithm from other threads, so that validation does not slow the updates down by the cost of BruteForce.
+// The experiment's thread sends every Append and Expire to each validation thread over a lock-free single producer single
+// consumer ring, and each thread replays them on its own BruteForce. Every sample-th step the experiment's thread also takes
+// a snapshot of the algorithm's answers (the top-k, the count and top-k membership of the packet's flow and the total),
+// which costs O(k), and one thread in turn compares it against its BruteForce. The mismatches are reported with their iteration
+// as they are found and counted, they do not stop the experiment. Several threads share the comparisons, which are the cost.
+class AsyncValidator{
+protected:
+    typedef boost::lockfree::spsc_queue<ValidationOp> OpRing;
+    typedef boost::lockfree::spsc_queue<FlowCountPair> ResultRing;
+
+    static const uint ring_size = 65536;  // The capacity of each ring
+    static const uint max_reports = 10;  // The number of mismatches each thread prints, the rest are only counted
+
+    // A validation thread and its rings
+    struct Worker{
+        OpRing ops;  // The operations, from the experiment's thread
+        ResultRing results;  // The top-k snapshots of the sampled operations
+        BruteForceAlgorithm validator;  // The validating algorithm
+        HittersQueryResult valid_results;  // The exact top-k, kept at class level to amortize allocation costs
+        HittersQueryResult checked_results;  // The snapshot's top-k, for the same reason
+        AccuracyStats accuracy;  // The accuracy of an approximate algorithm, which is measured instead of validated
+        uint failures;  // The number of mismatches found
+        boost::thread * thread;
+
+        Worker()
+        :ops(ring_size), results(ring_size), failures(0), thread(NULL) {}
+    };
+
+    std::vector<Worker*> workers;
+    uint k;  // The number of heaviest hitters validated
+    uint sample;  // Every sample-th step is validated
+    bool exact;  // Whether the algorithm's answers must match, otherwise their accuracy is measured
+    uint samples;  // The number of sampled steps so far, which picks the thread to validate the next one
+    uint64_t stalls;  // The number of waits for room on a full ring
+    HittersQueryResult snapshot;  // The top-k of a sampled step, kept at class level to amortize allocation costs
+
+    static boost::mutex & OutputMutex(){  // Serializes the threads' reports
+        static boost::mutex mutex;
+        return mutex;
+    }
+
+public:
+    // Constructor, starts the validation threads of an algorithm's top-k every sample-th step
+    AsyncValidator(uint threads, uint k, uint sample, bool exact)
+    :k(k), sample(sample), exact(exact), samples(0), stalls(0)
+    {
+        snapshot.reserve(k);
+        for(uint i=0; i<threads; ++i){
+            workers.push_back(new Worker);
+            workers.back()->valid_results.reserve(k);
+            workers.back()->checked_results.reserve(k);
+        }
+        foreach(Worker * w, workers)
+            w->thread = new boost::thread(boost::bind(&AsyncValidator::Run, this, w));
+    }
+
+    ~AsyncValidator(){
+        Finish();
+        foreach(Worker * w, workers)
+            delete w;
+    }
+
+    // Starts every BruteForce from the same flows, heaviest first, before any operation is sent. Returns false if they cannot be.
+    bool Restore(const FlowCountPair * flows, uint n){
+        bool restored = true;
+        foreach(Worker * w, workers)  // The threads wait for operations, the push of the first one publishes the restored state
+            restored = w->validator.Restore(flows, n) && restored;
+        return restored;
+    }
+
+    // Sends an appended packet, after the algorithm has been updated
+    void Append(Packet & packet, uint iteration, Algorithm * algorithm){
+        Send(ValidationOp(ValidationOp::APPEND, packet.flowp, iteration), algorithm);
+    }
+
+    // Sends an expired packet, after the algorithm has been updated
+    void Expire(Packet & packet, uint iteration, Algorithm * algorithm){
+        Send(ValidationOp(ValidationOp::EXPIRE, packet.flowp, iteration), algorithm);
+    }
+
+    // Waits for the threads to validate every operation sent and stops them
+    void Finish(){
+        foreach(Worker * w, workers){
+            if(w->thread == NULL)
+                continue;
+            Push(w, ValidationOp(ValidationOp::STOP, NULL, 0));
+            w->thread->join();
+            delete w->thread;
+            w->thread = NULL;
+        }
+    }
+
+    // Returns the number of mismatches found, complete after Finish()
+    uint Failures() const {
+        uint failures = 0;
+        foreach(const Worker * w, workers)
+            failures += w->failures;
+        return failures;
+    }
+
+    // Returns the measured accuracy of an approximate algorithm, complete after Finish()
+    AccuracyStats Accuracy() const {
+        AccuracyStats accuracy;
+        foreach(const Worker * w, workers)
+            accuracy += w->accuracy;
+        return accuracy;
+    }
+
+    // Returns the number of waits for a validation thread to catch up
+    uint64_t Stalls() const {
+        return stalls;
+    }
+
+protected:
+    // Sends an operation to every thread, with a snapshot of the algorithm's answers to one of them when the step is sampled
+    void Send(ValidationOp op, Algorithm * algorithm){
+        Worker * checker = NULL;
+        ValidationOp checked = op;
+        if(op.iteration % sample == 0){
+            checker = workers[samples++ % workers.size()];
+            snapshot.clear();
+            algorithm->QueryHeaviest(k, snapshot);
+            checked.sampled = true;
+            checked.results = snapshot.size();
+            checked.count = algorithm->GetCount(op.flowp);
+            checked.in_topk = algorithm->IsInTopK(op.flowp, k);
+            checked.total = algorithm->TotalCount();
+        }
+        foreach(Worker * w, workers){
+            if(w != checker){
+                Push(w, op);
+                continue;
+            }
+            Push(w, checked);  // The operation goes first, so that a snapshot larger than the ring cannot deadlock
+            const FlowCountPair * next = snapshot.empty() ? NULL : &snapshot[0];
+            for(uint left = snapshot.size(); left > 0;){
+                uint pushed = w->results.push(next, left);
+                next += pushed;
+                left -= pushed;
+                if(left > 0)
+                    Wait();
+            }
+        }
+    }
+
+    // Pushes an operation, waiting while the ring is full
+    void Push(Worker * w, const ValidationOp & op){
+        while(!w->ops.push(op))
+            Wait();
+    }
+
+    // Counts a wait for a full ring and yields to the validation threads
+    void Wait(){
+        stalls++;
+        boost::this_thread::yield();
+    }
+
+    // The body of a validation thread, replays and validates the operations until told to stop
+    void Run(Worker * w){
+        ValidationOp op;
+        while(true){
+            if(!w->ops.pop(op)){
+                boost::this_thread::yield();
+                continue;
+            }
+            Packet packet(op.flowp, 0);
+            switch(op.type){
+            case ValidationOp::APPEND: w->validator.Append(packet); break;
+            case ValidationOp::EXPIRE: w->validator.Expire(packet); break;
+            case ValidationOp::STOP: return;
+            }
+            if(!op.sampled)
+                continue;
+            w->checked_results.resize(op.results);
+            for(uint got = 0; got < op.results;){
+                uint popped = w->results.pop(&w->checked_results[got], op.results - got);
+                got += popped;
+                if(got < op.results)
+                    boost::this_thread::yield();
+            }
+            if(exact)
+                Validate(w, op);
+            else
+                w->accuracy.Record(w->checked_results, w->validator, k);
+        }
+    }
+
+    // Validates a snapshot against BruteForce. The top-k must have the exact counts of the k heaviest and each of its flows
+    // its exact count, so flows tied with the k-th may differ.
+    void Validate(Worker * w, const ValidationOp & op){
+        BruteForceAlgorithm & v = w->validator;
+        w->valid_results.clear();
+        v.QueryHeaviest(k, w->valid_results);
+        bool valid = (w->checked_results.size() == w->valid_results.size()) && op.total == v.TotalCount()
+                     && op.count == v.GetCount(op.flowp) && op.in_topk == v.IsInTopK(op.flowp, k);
+        for(uint i=0; valid && i<w->checked_results.size(); ++i)
+            valid = w->checked_results[i].second == w->valid_results[i].second
+                    && v.GetCount(w->checked_results[i].first) == w->checked_results[i].second;
+        if(valid)
+            return;
+
+        if(++w->failures > max_reports)
+            return;
+        boost::lock_guard<boost::mutex> lock(OutputMutex());
+        std::cout << "At iteration " << op.iteration << " asynchronous validation failed!" << std::endl;
+        std::cout << "Valid Results   :" << w->valid_results << ", Count/InTopK/Total:" << v.GetCount(op.flowp)
+                  << "/" << v.IsInTopK(op.flowp, k) << "/" << v.TotalCount() << std::endl;
+        std::cout << "Invalid Results :" << w->checked_results << ", Count/InTopK/Total:" << op.count
+                  << "/" << op.in_topk << "/" << op.total << std::endl;
+        if(w->failures == max_reports)
+            std::cout << "Further failures of this validation thread are only counted" << std::endl;
+    }
+};
+
+#endif /* ASYNCVALIDATOR_H_ */
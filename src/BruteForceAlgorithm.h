@@ -19,7 +19,7 @@ You should have received a copy of the GNU General Public License
 along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#ifndef BRUTEFORCEALGORITHM_Hs_
+#ifndef BRUTEFORCEALGORITHM_H_
 #define BRUTEFORCEALGORITHM_H_
 
 #include "Common.h"
@@ -30,16 +30,47 @@ class BruteForceAlgorithm : public Algorithm {
     // Returns true if p>q, used in sorting
     static bool IsBigger(FlowCountPair p, FlowCountPair q)  { return p.second > q.second; }
 
+    // Up to this k QueryHeaviest selects the heaviest flows in a single scan of the map into a small sorted buffer,
+    // above it the map is copied and partially selected
+    static const uint small_k = 16;
+
 public:
     // A vector of FlowP-Count Pairs used in QueryHeaviest as a intermediate sorting container.
     // Kept at class level to amortize initialization/allocation costs
     HittersQueryResult flow_counts;
 
+    // The memory usage of flow_count_dict, recorded when tracking is enabled
+    AllocationStats memory;
+    bool track_memory;  // Whether the memory usage and the operations are recorded
+
     // A map (hash table) of Flow->Count which is used in Append and Expire to record the counts
     FlowCountMap flow_count_dict;
 
+    // The sum of the counts in flow_count_dict
+    uint total_count;
+
+    // The result of the last QueryHeaviest and its k, reused until an update makes it dirty
+    HittersQueryResult heaviest;
+    uint heaviest_k;
+    bool dirty;
+
+    // A vector of counts used in QueryHistogram as a intermediate sorting container.
+    // Kept at class level to amortize initialization/allocation costs
+    std::vector<uint> counts;
+
+    // Constructor, track_memory enables recording the memory usage of the map
+    BruteForceAlgorithm(bool track_memory = false)
+    :track_memory(track_memory), flow_count_dict(FlowCountMap::allocator_type(track_memory ? &memory : NULL)), total_count(0), heaviest_k(0), dirty(true)
+    {
+        memory.EndSetup();
+    }
+
     // Executed when a new item is received
     virtual void Append(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count++;
+        dirty = true;
         FlowCountMap::iterator it = flow_count_dict.find(packet.flowp);  // Find the flow
         if(it != flow_count_dict.end())  // If it was found
             (it->second)++;  // Increment the count
@@ -49,6 +80,10 @@ public:
 
     // Executed when an item is served
     virtual void Expire(Packet& packet){
+        if(track_memory)
+            memory.operations++;
+        total_count--;
+        dirty = true;
         FlowCountMap::iterator it = flow_count_dict.find(packet.flowp);  // Find the flow
         if(it->second > 1)  // If this was not the flow's last packet in the queue
             (it->second)--;  // Decrement the count
@@ -56,26 +91,153 @@ public:
             flow_count_dict.erase(it);  // Remove the entry altogether
     }
 
-    // Calculates and returns the k Heaviest Hitters in the provided result container
+    // Empties the map, keeping its buckets
+    virtual bool Reset(){
+        flow_count_dict.clear();
+        total_count = 0;
+        dirty = true;
+        memory.Restart();
+        return true;
+    }
+
+    // Rebuilds the map from n flows, heaviest first, on an empty algorithm
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        if(!flow_count_dict.empty())
+            return false;
+        for(uint i=0; i<n; ++i){
+            if(flows[i].second == 0 || !flow_count_dict.insert(flows[i]).second)
+                return false;
+            total_count += flows[i].second;
+        }
+        dirty = true;
+        return true;
+    }
+
+    // Returns the memory usage of flow_count_dict
+    virtual AllocationStats MemoryStats(){
+        return memory;
+    }
+
+    // Calculates and returns the k Heaviest Hitters in the provided result container.
+    // Repeated queries without an update in between return the cached result.
     virtual void QueryHeaviest(uint k, HittersQueryResult & result){
-        if (flow_count_dict.size() == 0)  // If there are no counted items (queue is empty)
-            return;
+        if(dirty || k != heaviest_k){
+            heaviest.clear();
+            if(k <= small_k)
+                ScanHeaviest(k);
+            else
+                SelectHeaviest(k);
+            heaviest_k = k;
+            dirty = false;
+        }
+        result.insert(result.end(), heaviest.begin(), heaviest.end());
+    }
 
-        // Clear flow_counts in preparation for use
+    // Writes the flows with a count of at least c, heaviest first, into result (at most max_results) and returns their number
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results){
+        // Collect the flows at or above the threshold
         flow_counts.clear();
+        for(FlowCountMap::iterator it = flow_count_dict.begin(); it != flow_count_dict.end(); ++it)
+            if(it->second >= c)
+                flow_counts.push_back(*it);
+
+        // Sort only as many as will be returned
+        uint n = std::min((uint)flow_counts.size(), max_results);
+        std::partial_sort(flow_counts.begin(), flow_counts.begin() + n, flow_counts.end(), IsBigger);
+        std::copy(flow_counts.begin(), flow_counts.begin() + n, result);
+        return n;
+    }
 
-        // Copy map to vector for sorting on counts
-        std::copy(flow_count_dict.begin(), flow_count_dict.end(), back_inserter(flow_counts));
+    // Returns the number of packets currently counted
+    virtual uint TotalCount(){
+        return total_count;
+    }
+
+    // Returns the count of a flow, 0 if it is not counted
+    virtual uint GetCount(FlowP flowp){
+        FlowCountMap::iterator it = flow_count_dict.find(flowp);
+        return (it != flow_count_dict.end()) ? it->second : 0;
+    }
+
+    // Returns 1 + the number of flows with a greater count than flowp, 0 if it is not counted. Scans every flow.
+    virtual uint Rank(FlowP flowp){
+        uint count = GetCount(flowp);
+        if(count == 0)
+            return 0;
+        uint rank = 1;
+        for(FlowCountMap::iterator it = flow_count_dict.begin(); it != flow_count_dict.end(); ++it)
+            if(it->second > count)
+                rank++;
+        return rank;
+    }
+
+    // Returns the number of flows at each count in the provided result container. Sorts every count.
+    virtual void QueryHistogram(FlowSizeHistogram & result){
+        counts.clear();
+        for(FlowCountMap::iterator it = flow_count_dict.begin(); it != flow_count_dict.end(); ++it)
+            counts.push_back(it->second);
+        std::sort(counts.begin(), counts.end());
+        foreach(uint c, counts){
+            if(!result.empty() && result.back().first == c)
+                result.back().second++;
+            else
+                result.push_back(CountFlowsPair(c, 1));
+        }
+    }
 
-        // Sort from biggest to smallest count
-        std::sort(flow_counts.begin(), flow_counts.end(), IsBigger);
+    // Returns the number of distinct counts among the flows
+    virtual uint DistinctCounts(){
+        FlowSizeHistogram histogram;
+        QueryHistogram(histogram);
+        return histogram.size();
+    }
+
+    // Returns the count of the flow at position ceil(q*flows) in increasing count order, 0 if no flows are counted
+    virtual uint FlowSizeQuantile(double q){
+        if(flow_count_dict.empty())
+            return 0;
+        counts.clear();
+        for(FlowCountMap::iterator it = flow_count_dict.begin(); it != flow_count_dict.end(); ++it)
+            counts.push_back(it->second);
+        uint pos = QuantilePosition(q, counts.size());
+        std::nth_element(counts.begin(), counts.begin() + pos - 1, counts.end());
+        return counts[pos - 1];
+    }
+
+    // Returns the Shannon entropy in bits of the distribution of the counted packets over the flows
+    virtual double FlowSizeEntropy(){
+        double entropy = 0.0;
+        for(FlowCountMap::iterator it = flow_count_dict.begin(); it != flow_count_dict.end(); ++it)
+            entropy += EntropyTerm(it->second, 1, total_count);
+        return entropy;
+    }
 
-        // Now copy the results to the result vector
-        HittersQueryResult::iterator cur_count_it = flow_counts.begin();
-        for(uint i=0;(i<k) && (cur_count_it!=flow_counts.end()) && (cur_count_it->second>0); ++cur_count_it, ++i){
-            result.push_back(*cur_count_it);
+protected:
+    // Selects the k heaviest flows into heaviest with one pass over the map, keeping them sorted in the buffer: O(F + k^2) without copying
+    void ScanHeaviest(uint k){
+        heaviest.reserve(k + 1);
+        for(FlowCountMap::iterator it = flow_count_dict.begin(); it != flow_count_dict.end(); ++it){
+            if(heaviest.size() == k && (k == 0 || it->second <= heaviest.back().second))
+                continue;  // Not heavier than the lightest selected flow, the common case
+            if(heaviest.size() == k)
+                heaviest.pop_back();
+            HittersQueryResult::iterator pos = heaviest.end();
+            while(pos != heaviest.begin() && (pos-1)->second < it->second)
+                --pos;
+            heaviest.insert(pos, *it);
         }
     }
+
+    // Selects the k heaviest flows into heaviest by copying the map and partially selecting it: O(F + k log k)
+    void SelectHeaviest(uint k){
+        flow_counts.clear();
+        std::copy(flow_count_dict.begin(), flow_count_dict.end(), back_inserter(flow_counts));
+        uint n = std::min((uint)flow_counts.size(), k);
+        if(n < flow_counts.size())  // Move the k heaviest to the front, in any order
+            std::nth_element(flow_counts.begin(), flow_counts.begin() + n, flow_counts.end(), IsBigger);
+        std::sort(flow_counts.begin(), flow_counts.begin() + n, IsBigger);  // and sort only them
+        heaviest.assign(flow_counts.begin(), flow_counts.begin() + n);
+    }
 };
 
 #endif /* BRUTEFORCEALGORITHM_H_ */
@@ -0,0 +1,160 @@
+/*
+Checkpoint.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "Common.h"
+#include "Network.h"
+#include "Algorithm.h"
+#include "Summary.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>  // For open()
+#include <unistd.h>  // For close()
+#include <sys/stat.h>  // For fstat()
+#include <sys/mman.h>  // For mmap()
+
+// A checkpoint holds the state of an experiment's queue and algorithm, so that a restarted monitor
+// continues with a full window instead of an empty one. It refers to flows by id only, so it is position independent
+// and is read in place through a memory mapping.
+//
+// File layout (all integers little endian):
+//   Header : CheckpointHeader (56 bytes)
+//   Queue  : queue_length x CheckpointPacket, from the front (oldest) to the back of the queue
+//   State  : a summary (see Summary.h) of the algorithm, whose entries are in the reverse order of the HL-Hitters count list
+struct CheckpointHeader{
+    char magic[8];  // "HLHCKPNT"
+    uint32_t version;  // The format version, currently 1
+    uint32_t flow_count;  // The number of flows, flow ids are in [1, flow_count]
+    uint32_t max_queue_size;  // The maximum queue size
+    uint32_t queue_length;  // The number of packets in the queue
+    uint64_t queue_offset;  // The file offset of the queue
+    uint64_t state_offset;  // The file offset of the state summary
+    uint64_t state_size;  // The size of the state summary
+    char reserved[8];
+};
+
+// A packet of the queue in a checkpoint
+struct CheckpointPacket{
+    uint32_t flow_id;  // The flow of the packet
+    uint32_t seq_num;  // Its sequence number
+    uint32_t length;  // Its length in bytes on the wire
+};
+
+// Writes a checkpoint of queue and algorithm. The file is written under a temporary name and renamed,
+// so an existing checkpoint is only replaced by a complete one.
+void WriteCheckpoint(const std::string & filename, uint flow_count, const PacketQueue & queue, Algorithm & algorithm){
+    std::vector<char> state;
+    SerializeSummary(algorithm, 0, state);
+
+    std::vector<CheckpointPacket> packets(queue.size());
+    for(uint i=0; i<queue.size(); ++i){
+        packets[i].flow_id = queue[i].flowp->id;
+        packets[i].seq_num = queue[i].seq_num;
+        packets[i].length = queue[i].length;
+    }
+
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "HLHCKPNT", 8);
+    header.version = 1;
+    header.flow_count = flow_count;
+    header.max_queue_size = queue.max_queue_size;
+    header.queue_length = packets.size();
+    header.queue_offset = sizeof(header);
+    header.state_offset = header.queue_offset + packets.size() * sizeof(CheckpointPacket);
+    header.state_size = state.size();
+
+    std::string tmpname = filename + ".tmp";
+    FILE * file = fopen(tmpname.c_str(), "wb");
+    bool ok = (file != NULL) && fwrite(&header, sizeof(header), 1, file) == 1
+              && (packets.empty() || fwrite(&packets[0], packets.size() * sizeof(CheckpointPacket), 1, file) == 1)
+              && fwrite(&state[0], state.size(), 1, file) == 1;
+    if(file != NULL)
+        ok = (fclose(file) == 0) && ok;
+    if(!ok || rename(tmpname.c_str(), filename.c_str()) != 0){
+        std::cout << "Error: Cannot write checkpoint " << filename << std::endl;
+        ::exit(-1);
+    }
+}
+
+
+// Reads a checkpoint in place through a memory mapping
+class CheckpointReader {
+    std::string filename;  // The file name of the checkpoint
+    const char * data;  // The start of the memory mapped file
+    std::size_t size;  // The size of the memory mapped file
+    const CheckpointHeader * header;  // The header, in the mapping
+
+public:
+    // Constructor, maps the checkpoint and checks its layout
+    CheckpointReader(const std::string & filename)
+    :filename(filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if(fd < 0 || fstat(fd, &st) != 0){
+            std::cout << "Error: Cannot open checkpoint " << filename << std::endl;
+            ::exit(-1);
+        }
+        size = st.st_size;
+        void * addr = (size >= sizeof(CheckpointHeader)) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if(addr == MAP_FAILED)
+            Fail("cannot map file");
+        data = (const char *)addr;
+
+        header = (const CheckpointHeader *)data;
+        if(std::memcmp(header->magic, "HLHCKPNT", 8) != 0 || header->version != 1)
+            Fail("not a checkpoint");
+        if(header->queue_offset != sizeof(CheckpointHeader)
+           || header->state_offset != header->queue_offset + (uint64_t)header->queue_length * sizeof(CheckpointPacket)
+           || header->state_offset > size || header->state_size != size - header->state_offset
+           || !State().Valid())
+            Fail("corrupt layout");
+    }
+
+    ~CheckpointReader(){
+        munmap((void*)data, size);
+    }
+
+    const CheckpointHeader & Header() const { return *header; }
+
+    // The packets of the queue, from the front
+    const CheckpointPacket * Queue() const {
+        return (const CheckpointPacket *)(data + header->queue_offset);
+    }
+
+    // The state of the algorithm
+    SummaryView State() const {
+        return SummaryView(data + header->state_offset, header->state_size);
+    }
+
+    void Fail(const char * reason) const {
+        std::cout << "Error: Cannot read checkpoint " << filename << ": " << reason << std::endl;
+        ::exit(-1);
+    }
+};
+
+#endif /* CHECKPOINT_H_ */
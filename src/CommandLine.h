@@ -25,6 +25,62 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 #include <tclap/CmdLine.h>
 #include "PredicateConstraint.h"
 #include "Experiment.h"
+#include "TeeExperiment.h"
+#include "PipelineExperiment.h"
+#include "Sweep.h"
+#include "Aggregate.h"
+#include "HugePages.h"
+
+// Returns the command line names of the algorithms, in the order they are listed
+std::vector<std::string> algorithmNames(){
+    using namespace boost::assign;
+    std::vector<std::string> names;
+    names += "noprocessing", "bruteforce", "hlhitters", "heap", "ostree", "streamsummary", "countmin", "hierarchical", "smallhlhitters";
+    return names;
+}
+
+// Returns the algorithm type of a command line algorithm name
+Experiment::AlgorithmType algorithmType(const std::string & name){
+    using namespace boost::assign;
+    std::map<std::string,Experiment::AlgorithmType> types;
+    insert( types )( "noprocessing", Experiment::NOPROCESSING )
+                   ( "bruteforce", Experiment::BRUTEFORCE )
+                   ( "hlhitters", Experiment::HLHITTERS)
+                   ( "heap", Experiment::HEAP )
+                   ( "ostree", Experiment::ORDERSTATISTICS )
+                   ( "streamsummary", Experiment::STREAMSUMMARY )
+                   ( "countmin", Experiment::COUNTMIN )
+                   ( "hierarchical", Experiment::HIERARCHICAL )
+                   ( "smallhlhitters", Experiment::SMALLHLHITTERS );
+    return types[name];
+}
+
+// Returns the command line names of the query modes, in the order of the QueryMode enum
+std::vector<std::string> queryModeNames(){
+    using namespace boost::assign;
+    std::vector<std::string> names;
+    names += "packet", "every", "period", "thread", "none";
+    return names;
+}
+
+// Returns the query mode of a command line query mode name
+Experiment::QueryMode queryMode(const std::string & name){
+    std::vector<std::string> names = queryModeNames();
+    return (Experiment::QueryMode)(std::find(names.begin(), names.end(), name) - names.begin());
+}
+
+// Returns the command line names of the page sizes
+std::vector<std::string> pageSizeNames(){
+    using namespace boost::assign;
+    std::vector<std::string> names;
+    names += "none", "2m", "1g";
+    return names;
+}
+
+// Returns the page size of a command line page size name, 0 for the normal pages
+std::size_t pageSize(const std::string & name){
+    return (name == "2m") ? HugePageArena::page_2m : (name == "1g") ? HugePageArena::page_1g : 0;
+}
 
 // Helper function to read Experiment execution parameters from a command line
 // Uses the TCLAP library
@@ -43,7 +99,7 @@ std::pair<Experiment::Params,uint> readExperimentParams(int argc, char **argv){
         ValueArg<uint> numArg("n", "numexec", "Number of identical sequential executions to perform (default=1)", false, 1, &posIntConstraint);
         cmd.add( numArg );
 
-        ValueArg<bool> valArg("v", "validate", "Validate the query results of HL-Hitters against BruteForce (only available when alg=hlhitters, default=0)", false, 0, "0|1");
+        ValueArg<bool> valArg("v", "validate", "Validate the query results of the algorithm against BruteForce, measuring the accuracy of the approximate ones (not available when alg=noprocessing, default=0)", false, 0, "0|1");
         cmd.add( valArg );
 
         ValueArg<uint> rngArg("r", "rng", "Seed to use for random number generator (default=1)", false, 1, &posIntConstraint);
@@ -52,12 +108,7 @@ std::pair<Experiment::Params,uint> readExperimentParams(int argc, char **argv){
         ValueArg<uint> kArg("k", "k", "Number of heaviest hitters to query (default=1)", false, 1, &posIntConstraint);
         cmd.add( kArg );
 
-        std::map<std::string,Experiment::AlgorithmType> allowedAlgorithms;
-        insert( allowedAlgorithms )( "noprocessing", Experiment::NOPROCESSING )
-                                   ( "bruteforce", Experiment::BRUTEFORCE )
-                                   ( "hlhitters", Experiment::HLHITTERS);
-        std::vector<std::string> allowedAlgorithmsStr;
-        allowedAlgorithmsStr += "noprocessing", "bruteforce", "hlhitters";
+        std::vector<std::string> allowedAlgorithmsStr = algorithmNames();
 
 
         ValuesConstraint<std::string> allowedAlgorithmsConstraint( allowedAlgorithmsStr );
@@ -76,21 +127,202 @@ std::pair<Experiment::Params,uint> readExperimentParams(int argc, char **argv){
         ValueArg<uint> expArg("e", "expnum", "Experiment Number (default=1)", false, 1, &posIntConstraint);
         cmd.add( expArg );
 
+        ValueArg<std::string> traceArg("t", "trace", "pcap/pcapng file to replay cyclically instead of generating packets uniformly, flows are its 5-tuples (default=none)", false, "", "file");
+        cmd.add( traceArg );
+
+        std::vector<std::string> allowedFormatsStr;
+        allowedFormatsStr += "text", "csv", "json";
+        ValuesConstraint<std::string> allowedFormatsConstraint( allowedFormatsStr );
+        ValueArg<std::string> formatArg("F", "format", "Output format: a text line, or csv/json (JSON Lines) rows per repetition with host info and rates net of the noprocessing baseline (default=text)", false, "text", &allowedFormatsConstraint);
+        cmd.add( formatArg );
+
+        PredicateConstraint<double> fractionConstraint(_1>=0.0 && _1<1.0, "A fraction in [0,1)");
+        ValueArg<double> phiArg("p", "phi", "Also query every flow holding more than this fraction of the queue after each append, 0 to disable (default=0)", false, 0.0, &fractionConstraint);
+        cmd.add( phiArg );
+
+        std::vector<std::string> allowedQueryModesStr = queryModeNames();
+        ValuesConstraint<std::string> allowedQueryModesConstraint( allowedQueryModesStr );
+        ValueArg<std::string> queryArg("Q", "query", "When to query the heaviest hitters: after every packet, every interval packets, after a packet once every interval microseconds, "
+                                       "from a separate thread every interval microseconds, or never (default=packet)", false, "packet", &allowedQueryModesConstraint);
+        cmd.add( queryArg );
+
+        ValueArg<uint> intervalArg("I", "interval", "Packets or microseconds between queries, see --query (default=1000)", false, 1000, &posIntConstraint);
+        cmd.add( intervalArg );
+
+        ValueArg<bool> notifyArg("N", "notify", "Subscribe to top-k change notifications instead of querying the top-k after each append (only available when alg=hlhitters, default=0)", false, 0, "0|1");
+        cmd.add( notifyArg );
+
+        ValueArg<uint> thresholdArg("T", "threshold", "When notifying, also notify when a flow's count crosses this threshold, 0 to disable (default=0)", false, 0, "int");
+        cmd.add( thresholdArg );
+
+        ValueArg<bool> memArg("M", "memstats", "Record and print the live/peak bytes and allocations per operation of the algorithm's data structure (default=0)", false, 0, "0|1");
+        cmd.add( memArg );
+
+        ValueArg<std::string> recordArg("o", "record", "File to record the algorithm's Append/Expire/QueryHeaviest operations into, for HL-Hitters-Replay (default=none)", false, "", "file");
+        cmd.add( recordArg );
+
+        ValueArg<std::string> checkpointArg("c", "checkpoint", "File to save the queue and the algorithm's state into when the queue is in its steady state, before it is drained (not available when alg=hierarchical, default=none)", false, "", "file");
+        cmd.add( checkpointArg );
+
+        ValueArg<std::string> restoreArg("R", "restore", "Checkpoint file to start from with a full queue instead of an empty one, of the same flows and queue size (not available when alg=hierarchical, default=none)", false, "", "file");
+        cmd.add( restoreArg );
+
+        PredicateConstraint<double> probabilityConstraint(_1>0.0 && _1<1.0, "A fraction in (0,1)");
+        ValueArg<double> epsilonArg("E", "epsilon", "Count error bound of countmin as a fraction of the queue size (default=0.001)", false, 0.001, &probabilityConstraint);
+        cmd.add( epsilonArg );
+
+        ValueArg<double> deltaArg("D", "delta", "Probability of countmin exceeding its count error bound (default=0.01)", false, 0.01, &probabilityConstraint);
+        cmd.add( deltaArg );
+
+        ValueArg<uint64_t> budgetArg("B", "budget", "Memory budget of countmin in bytes, overriding epsilon, 0 to size by epsilon (default=0)", false, 0, "bytes");
+        cmd.add( budgetArg );
+
+        ValueArg<uint> candidatesArg("C", "candidates", "Number of heavy flow candidates countmin keeps, 0 for 1/epsilon or a quarter of the budget (default=0)", false, 0, "int");
+        cmd.add( candidatesArg );
+
+        ValueArg<uint> vthreadsArg("A", "vthreads", "When validating, the number of threads to validate on without slowing the updates down, 0 to validate inline. "
+                                   "The threads validate the top-k, the count and top-k membership of the packet's flow and the total count (default=0)", false, 0, "int");
+        cmd.add( vthreadsArg );
+
+        ValueArg<uint> vsampleArg("S", "vsample", "When validating, validate every this many steps only (default=1)", false, 1, &posIntConstraint);
+        cmd.add( vsampleArg );
+
+        ValueArg<bool> checkArg("i", "check", "Check the invariants of the HL-Hitters structure around the touched nodes after each update in O(1), "
+                                "exiting on the first violation (only available when alg=hlhitters or hierarchical, default=0)", false, 0, "0|1");
+        cmd.add( checkArg );
+
+        ValueArg<std::string> teeArg("m", "tee", "Algorithms to feed the same generated packets to instead of alg, comma separated, each timed on its own "
+                                     "and the exact ones cross-checked (default=none)", false, "", "list");
+        cmd.add( teeArg );
+
+        ValueArg<uint> sliceArg("l", "slice", "Number of queue operations each tee algorithm runs in turn, 1 for round-robin per operation (default=1024)", false, 1024, &posIntConstraint);
+        cmd.add( sliceArg );
+
+        ValueArg<bool> pipelineArg("g", "pipeline", "Run the packet generator, the queue and the algorithm on separate threads connected by lock-free rings, "
+                                   "and report each stage's throughput and the end-to-end packet latency (default=0)", false, 0, "0|1");
+        cmd.add( pipelineArg );
+
+        ValueArg<uint> batchArg("b", "batch", "Number of items the pipeline stages write and read at a time (default=64)", false, 64, &posIntConstraint);
+        cmd.add( batchArg );
+
+        ValueArg<std::string> pinArg("x", "pin", "Cores to pin the generator, queue and algorithm stages of the pipeline to, comma separated (default=none)", false, "", "list");
+        cmd.add( pinArg );
+
+        std::vector<std::string> allowedPageSizesStr = pageSizeNames();
+        ValuesConstraint<std::string> allowedPageSizesConstraint( allowedPageSizesStr );
+        ValueArg<std::string> hugeArg("H", "huge", "Huge page size to back the queue and the hlhitters/hierarchical structures with, "
+                                      "reserved hugetlbfs pages if there are any and transparent huge pages otherwise (default=none)", false, "none", &allowedPageSizesConstraint);
+        cmd.add( hugeArg );
+
+        ValueArg<int> numaArg("U", "numa", "NUMA node to bind the huge pages to, -1 for the node of the thread using them (default=-1)", false, -1, "int");
+        cmd.add( numaArg );
+
+        ValueArg<std::string> resizeArg("w", "resize", "Queue sizes to resize the queue to in turn during the run, comma separated values and from:to[:step] ranges. "
+                                        "Shrinking serves the oldest packets at once (default=none)", false, "", "list");
+        cmd.add( resizeArg );
+
+        ValueArg<uint> resizeEveryArg("W", "resize-every", "Number of packets appended between resizes, see --resize (default=10000)", false, 10000, &posIntConstraint);
+        cmd.add( resizeEveryArg );
+
+        ValueArg<std::string> prefixesArg("P", "prefixes", "Source address prefix lengths of the hierarchical levels, increasing and in [1,32] (default=16,24,32)", false, "16,24,32", "list");
+        cmd.add( prefixesArg );
+
         // Parse the args.
         cmd.parse( argc, argv );
 
-        if(allowedAlgorithms[algArg.getValue()]!=Experiment::HLHITTERS  && valArg.getValue())
-            throw ArgException("Cannot validate results for algorithms other than hlhitters", "alg & validate");
+        if(algorithmType(algArg.getValue())==Experiment::NOPROCESSING  && valArg.getValue() && teeArg.getValue().empty())
+            throw ArgException("Cannot validate results for the noprocessing algorithm", "alg & validate");
+        if(algorithmType(algArg.getValue())!=Experiment::HLHITTERS  && notifyArg.getValue())
+            throw ArgException("Cannot notify changes for algorithms other than hlhitters", "alg & notify");
+        if(algorithmType(algArg.getValue())!=Experiment::HLHITTERS && algorithmType(algArg.getValue())!=Experiment::HIERARCHICAL && checkArg.getValue())
+            throw ArgException("Cannot check the invariants of algorithms other than hlhitters and hierarchical", "alg & check");
+        if(algorithmType(algArg.getValue())==Experiment::HIERARCHICAL && (!checkpointArg.getValue().empty() || !restoreArg.getValue().empty()))
+            throw ArgException("Cannot checkpoint or restore the hierarchical algorithm", "alg & checkpoint");
 
         Experiment::Params p;
         p.number = expArg.getValue();
         p.seq_size = seqArg.getValue();
         p.flow_count =  flowsArg.getValue();
         p.max_queue_size = queueArg.getValue();
-        p.alg_type = allowedAlgorithms[algArg.getValue()];
+        p.alg_type = algorithmType(algArg.getValue());
         p.k_heaviest = kArg.getValue();
         p.random_seed = rngArg.getValue();
         p.validation = valArg.getValue();
+        p.validation_threads = vthreadsArg.getValue();
+        p.validation_sample = vsampleArg.getValue();
+        p.check = checkArg.getValue();
+        p.trace_file = traceArg.getValue();
+        p.oplog_file = recordArg.getValue();
+        p.checkpoint_file = checkpointArg.getValue();
+        p.restore_file = restoreArg.getValue();
+        p.memory_stats = memArg.getValue();
+        p.phi = phiArg.getValue();
+        p.notify = notifyArg.getValue();
+        p.threshold = thresholdArg.getValue();
+        p.query_mode = queryMode(queryArg.getValue());
+        p.query_interval = intervalArg.getValue();
+        try{
+            if(!resizeArg.getValue().empty())
+                p.resize_sizes = ParseUintList(resizeArg.getValue());
+        }catch(std::invalid_argument & e){
+            throw ArgException(e.what(), "resize");
+        }
+        if(std::find(p.resize_sizes.begin(), p.resize_sizes.end(), 0) != p.resize_sizes.end())
+            throw ArgException("The queue sizes must be positive integers", "resize");
+        if(p.alg_type == Experiment::SMALLHLHITTERS && !p.resize_sizes.empty()
+           && *std::max_element(p.resize_sizes.begin(), p.resize_sizes.end()) > SmallHLHittersCapacity(p.max_queue_size))
+            throw ArgException("The smallhlhitters algorithm cannot grow beyond the capacity it is built with for the queue size", "resize");
+        p.resize_every = resizeEveryArg.getValue();
+        if(!p.oplog_file.empty() && p.query_mode == Experiment::QUERY_THREAD)
+            throw ArgException("The queries of the query thread are not recorded, query from the update thread instead", "record & query");
+        if(!p.resize_sizes.empty() && (!p.oplog_file.empty() || !p.checkpoint_file.empty()))
+            throw ArgException("The recordings and checkpoints have a fixed queue size", "resize");
+        p.huge_pages = pageSize(hugeArg.getValue());
+        p.numa_node = numaArg.getValue();
+        if(p.numa_node >= 0 && p.huge_pages == 0)
+            throw ArgException("Only the huge pages are bound to a NUMA node", "numa & huge");
+        p.sketch.epsilon = epsilonArg.getValue();
+        p.sketch.delta = deltaArg.getValue();
+        p.sketch.memory_budget = budgetArg.getValue();
+        p.sketch.candidates = candidatesArg.getValue();
+        try{
+            p.prefix_lengths = ParseUintList(prefixesArg.getValue());
+        }catch(std::invalid_argument & e){
+            throw ArgException(e.what(), "prefixes");
+        }
+        for(uint i=0; i<p.prefix_lengths.size(); ++i)
+            if(p.prefix_lengths[i] < 1 || p.prefix_lengths[i] > 32 || (i > 0 && p.prefix_lengths[i] <= p.prefix_lengths[i-1]))
+                throw ArgException("Prefix lengths must be increasing and in [1,32]", "prefixes");
+        p.output_format = (formatArg.getValue() == "csv") ? Experiment::CSV : (formatArg.getValue() == "json") ? Experiment::JSON : Experiment::TEXT;
+
+        std::vector<std::string> names = algorithmNames();
+        std::stringstream tee(teeArg.getValue());
+        std::string alg;
+        while(std::getline(tee, alg, ',')){
+            if(std::find(names.begin(), names.end(), alg) == names.end())
+                throw ArgException("Unknown algorithm '" + alg + "'", "tee");
+            p.tee.push_back(algorithmType(alg));
+        }
+        p.tee_slice = sliceArg.getValue();
+        if(!p.tee.empty() && (p.validation || p.notify || p.check || !p.oplog_file.empty() || !p.checkpoint_file.empty() || !p.restore_file.empty()
+                              || !p.resize_sizes.empty()))
+            throw ArgException("The tee algorithms are cross-checked, and cannot be validated, notify, check invariants, record, checkpoint or resize", "tee");
+        if(!p.tee.empty() && (p.query_mode == Experiment::QUERY_PERIOD || p.query_mode == Experiment::QUERY_THREAD))
+            throw ArgException("The tee algorithms query after every packet, every interval packets or never", "tee & query");
+
+        p.pipeline = pipelineArg.getValue();
+        p.pipeline_batch = batchArg.getValue();
+        try{
+            if(!pinArg.getValue().empty())
+                p.pipeline_cores = ParseUintList(pinArg.getValue());
+        }catch(std::invalid_argument & e){
+            throw ArgException(e.what(), "pin");
+        }
+        if(p.pipeline && (p.validation || p.notify || !p.tee.empty() || !p.oplog_file.empty() || !p.checkpoint_file.empty() || !p.restore_file.empty()
+                          || !p.resize_sizes.empty()))
+            throw ArgException("The pipeline cannot be validated, notify, tee, record, checkpoint or resize", "pipeline");
+        if(p.pipeline && p.query_mode == Experiment::QUERY_THREAD)
+            throw ArgException("The pipeline's algorithm stage runs the queries itself", "pipeline & query");
 
         uint numexec = numArg.getValue();
 
@@ -103,5 +335,314 @@ std::pair<Experiment::Params,uint> readExperimentParams(int argc, char **argv){
 }
 
 
+// Helper function to read operation log replay parameters from a command line
+// Returns the log file name, the algorithm to replay it on and the number of executions
+std::pair<std::pair<std::string,Experiment::AlgorithmType>,uint> readReplayParams(int argc, char **argv){
+    using namespace boost::lambda;
+    using namespace TCLAP;
+
+    try {
+        CmdLine cmd("HL-Hitters operation log replay in C++", ' ', "0.3");
+
+        PredicateConstraint<uint> posIntConstraint(_1>0, "A positive integer");
+        ValueArg<uint> numArg("n", "numexec", "Number of identical sequential executions to perform (default=1)", false, 1, &posIntConstraint);
+        cmd.add( numArg );
+
+        std::vector<std::string> allowedAlgorithmsStr = algorithmNames();
+
+        ValuesConstraint<std::string> allowedAlgorithmsConstraint( allowedAlgorithmsStr );
+        ValueArg<std::string> algArg("a", "alg", "Algorithm to replay the log on (default=hlhitters)", false, "hlhitters", &allowedAlgorithmsConstraint);
+        cmd.add( algArg );
+
+        ValueArg<std::string> logArg("l", "log", "Operation log recorded with HL-Hitters --record", true, "", "file");
+        cmd.add( logArg );
+
+        cmd.parse( argc, argv );
+
+        return std::make_pair(std::make_pair(logArg.getValue(), algorithmType(algArg.getValue())), numArg.getValue());
+
+    } catch (ArgException &e) {  // catch any exceptions
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+        exit(-1);
+    }
+}
+
+// Helper function to read the parameter grid of a sweep from a command line and/or a configuration file.
+// Options given on the command line override those of the configuration file.
+SweepParams readSweepParams(int argc, char **argv){
+    using namespace boost::lambda;
+    using namespace TCLAP;
+
+    try {
+        CmdLine cmd("HL-Hitters parallel experiment sweep in C++. List options take comma separated values and from:to[:step] ranges.", ' ', "0.3");
+
+        ValueArg<std::string> configArg("c", "config", "Configuration file of 'option = value' lines using the long option names below (default=none)", false, "", "file");
+        cmd.add( configArg );
+
+        ValueArg<bool> resumeArg("R", "resume", "Keep the rows already in the output file and only run the missing repetitions (default=0)", false, 0, "0|1");
+        cmd.add( resumeArg );
+
+        ValueArg<std::string> formatArg("F", "format", "Output format, csv or json lines (default=csv)", false, "csv", "csv|json");
+        cmd.add( formatArg );
+
+        ValueArg<std::string> outArg("O", "output", "Output file, one row per repetition (default=sweep.csv)", false, "sweep.csv", "file");
+        cmd.add( outArg );
+
+        ValueArg<std::string> coresArg("C", "cores", "Cores to run experiments on, one at a time per core (default=all online cores)", false, "", "list");
+        cmd.add( coresArg );
+
+        ValueArg<std::string> numArg("n", "numexec", "Number of repetitions of each configuration (default=10)", false, "10", "int");
+        cmd.add( numArg );
+
+        ValueArg<std::string> valArg("v", "validate", "Validate the query results against BruteForce (default=0)", false, "0", "0|1");
+        cmd.add( valArg );
+
+        ValueArg<std::string> memArg("M", "memstats", "Record the memory usage of the algorithms (default=0)", false, "0", "0|1");
+        cmd.add( memArg );
+
+        ValueArg<std::string> queryArg("Q", "query", "When to query the heaviest hitters, see HL-Hitters --query (default=packet)", false, "packet", "packet|every|period|thread|none");
+        cmd.add( queryArg );
+
+        ValueArg<std::string> intervalArg("I", "interval", "Packets or microseconds between queries (default=1000)", false, "1000", "int");
+        cmd.add( intervalArg );
+
+        ValueArg<std::string> traceArg("t", "trace", "pcap/pcapng file to replay in every configuration (default=none)", false, "", "file");
+        cmd.add( traceArg );
+
+        ValueArg<std::string> rngArg("r", "rng", "Seeds to use for the random number generator (default=1)", false, "1", "list");
+        cmd.add( rngArg );
+
+        ValueArg<std::string> kArg("k", "k", "Numbers of heaviest hitters to query (default=1)", false, "1", "list");
+        cmd.add( kArg );
+
+        ValueArg<std::string> algArg("a", "alg", "Algorithms to use (default=noprocessing,bruteforce,hlhitters)", false, "noprocessing,bruteforce,hlhitters", "list");
+        cmd.add( algArg );
+
+        ValueArg<std::string> queueArg("q", "queue", "Maximum queue sizes in items (default=50)", false, "50", "list");
+        cmd.add( queueArg );
+
+        ValueArg<std::string> flowsArg("f", "flows", "Numbers of flows to use (default=100)", false, "100", "list");
+        cmd.add( flowsArg );
+
+        ValueArg<std::string> seqArg("s", "seqsize", "Numbers of items to process (default=10000)", false, "10000", "list");
+        cmd.add( seqArg );
+
+        cmd.parse( argc, argv );
+
+        // Option values: the command line, else the configuration file, else the default
+        std::map<std::string,std::string> config;
+        if(!configArg.getValue().empty())
+            config = ReadSweepConfig(configArg.getValue());
+        std::vector<ValueArg<std::string>*> args;
+        args.push_back(&formatArg); args.push_back(&outArg); args.push_back(&coresArg);
+        args.push_back(&numArg); args.push_back(&valArg); args.push_back(&memArg);
+        args.push_back(&queryArg); args.push_back(&intervalArg); args.push_back(&traceArg); args.push_back(&rngArg);
+        args.push_back(&kArg); args.push_back(&algArg); args.push_back(&queueArg); args.push_back(&flowsArg); args.push_back(&seqArg);
+        std::map<std::string,std::string> value;
+        foreach(ValueArg<std::string>* arg, args)
+            value[arg->getName()] = (!arg->isSet() && config.count(arg->getName())) ? config[arg->getName()] : arg->getValue();
+        value["resume"] = (resumeArg.isSet() || !config.count("resume")) ? (resumeArg.getValue() ? "1" : "0") : config["resume"];
+        typedef std::map<std::string,std::string>::value_type ConfigEntry;
+        foreach(const ConfigEntry & e, config)
+            if(!value.count(e.first))
+                throw ArgException("Unknown option '" + e.first + "' in the configuration file", "config");
+
+        SweepParams sp;
+        std::vector<std::string> names = algorithmNames();
+        std::stringstream algs(value["alg"]);
+        std::string alg;
+        while(std::getline(algs, alg, ',')){
+            if(std::find(names.begin(), names.end(), alg) == names.end())
+                throw ArgException("Unknown algorithm '" + alg + "'", "alg");
+            sp.alg_types.push_back(algorithmType(alg));
+        }
+        sp.seq_sizes = ParseUintList(value["seqsize"]);
+        sp.flow_counts = ParseUintList(value["flows"]);
+        sp.max_queue_sizes = ParseUintList(value["queue"]);
+        sp.k_heaviests = ParseUintList(value["k"]);
+        sp.random_seeds = ParseUintList(value["rng"]);
+        sp.validation = (value["validate"] == "1");
+        sp.memory_stats = (value["memstats"] == "1");
+        std::vector<std::string> modes = queryModeNames();
+        if(std::find(modes.begin(), modes.end(), value["query"]) == modes.end())
+            throw ArgException("Unknown query mode '" + value["query"] + "'", "query");
+        sp.query_mode = queryMode(value["query"]);
+        std::vector<uint> interval = ParseUintList(value["interval"]);
+        if(interval.size() != 1 || interval[0] == 0)
+            throw ArgException("The query interval must be one positive integer", "interval");
+        sp.query_interval = interval[0];
+        sp.trace_file = value["trace"];
+        std::vector<uint> times = ParseUintList(value["numexec"]);
+        sp.times = times.empty() ? 0 : times[0];
+
+        sp.cores = ParseUintList(value["cores"]);
+        if(sp.cores.empty())
+            for(uint c=0; c<OnlineCores(); ++c) sp.cores.push_back(c);
+        sp.output_file = value["output"];
+        if(value["format"] != "csv" && value["format"] != "json")
+            throw ArgException("Unknown output format '" + value["format"] + "'", "format");
+        sp.format = (value["format"] == "csv") ? Experiment::CSV : Experiment::JSON;
+        sp.resume = (value["resume"] == "1");
+
+        if(sp.times == 0 || sp.alg_types.empty() || sp.seq_sizes.empty() || sp.flow_counts.empty() || sp.max_queue_sizes.empty()
+           || sp.k_heaviests.empty() || sp.random_seeds.empty())
+            throw ArgException("Every grid dimension needs at least one value", "grid");
+        foreach(uint v, sp.seq_sizes) if(v == 0) throw ArgException("Values must be positive integers", "seqsize");
+        foreach(uint v, sp.flow_counts) if(v == 0) throw ArgException("Values must be positive integers", "flows");
+        foreach(uint v, sp.max_queue_sizes) if(v == 0) throw ArgException("Values must be positive integers", "queue");
+        foreach(uint v, sp.k_heaviests) if(v == 0) throw ArgException("Values must be positive integers", "k");
+        if(sp.validation && std::count(sp.alg_types.begin(), sp.alg_types.end(), Experiment::NOPROCESSING))
+            throw ArgException("Cannot validate results for the noprocessing algorithm", "alg & validate");
+
+        return sp;
+
+    } catch (ArgException &e) {  // catch any exceptions
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+        exit(-1);
+    } catch (std::invalid_argument &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        exit(-1);
+    }
+}
+
+// Helper function to read the parameters of a multi-node aggregation benchmark from a command line
+AggregateParams readAggregateParams(int argc, char **argv){
+    using namespace boost::lambda;
+    using namespace TCLAP;
+
+    try {
+        CmdLine cmd("HL-Hitters multi-node summary aggregation in C++", ' ', "0.3");
+
+        PredicateConstraint<uint> posIntConstraint(_1>0, "A positive integer");
+        ValueArg<uint> numArg("n", "numexec", "Number of timed merges for each number of nodes (default=10)", false, 10, &posIntConstraint);
+        cmd.add( numArg );
+
+        ValueArg<bool> valArg("v", "validate", "Validate the global top-k against BruteForce runs of the same node experiments (default=0)", false, 0, "0|1");
+        cmd.add( valArg );
+
+        ValueArg<std::string> nodesArg("N", "nodes", "Numbers of nodes (processes) to aggregate, comma separated values and from:to[:step] ranges (default=1,2,4,8)", false, "1,2,4,8", "list");
+        cmd.add( nodesArg );
+
+        ValueArg<uint> rngArg("r", "rng", "Seed to use for the random number generator of the first node, node i uses seed+i (default=1)", false, 1, &posIntConstraint);
+        cmd.add( rngArg );
+
+        ValueArg<uint> kArg("k", "k", "Number of global heaviest hitters to query (default=1)", false, 1, &posIntConstraint);
+        cmd.add( kArg );
+
+        std::vector<std::string> allowedAlgorithmsStr = algorithmNames();
+        ValuesConstraint<std::string> allowedAlgorithmsConstraint( allowedAlgorithmsStr );
+        ValueArg<std::string> algArg("a", "alg", "Algorithm the nodes use (default=hlhitters)", false, "hlhitters", &allowedAlgorithmsConstraint);
+        cmd.add( algArg );
+
+        ValueArg<uint> queueArg("q", "queue", "Maximum queue size in items of each node (default=50)", false, 50, &posIntConstraint);
+        cmd.add( queueArg );
+
+        ValueArg<uint> flowsArg("f", "flows", "Number of flows to use (default=100)", false, 100, &posIntConstraint);
+        cmd.add( flowsArg );
+
+        ValueArg<uint> seqArg("s", "seqsize", "Number of items each node processes before sending its summary (default=10000)", false, 10000, &posIntConstraint);
+        cmd.add( seqArg );
+
+        cmd.parse( argc, argv );
+
+        if(algorithmType(algArg.getValue())==Experiment::NOPROCESSING)
+            throw ArgException("The noprocessing algorithm keeps no state to summarize", "alg");
+
+        AggregateParams ap;
+        ap.params.seq_size = seqArg.getValue();
+        ap.params.flow_count = flowsArg.getValue();
+        ap.params.max_queue_size = queueArg.getValue();
+        ap.params.alg_type = algorithmType(algArg.getValue());
+        ap.params.k_heaviest = kArg.getValue();
+        ap.params.random_seed = rngArg.getValue();
+        ap.params.validation = valArg.getValue();
+        ap.params.query_mode = Experiment::QUERY_NONE;  // Only the state at the end matters
+        ap.node_counts = ParseUintList(nodesArg.getValue());
+        ap.times = numArg.getValue();
+        if(ap.node_counts.empty() || std::find(ap.node_counts.begin(), ap.node_counts.end(), 0) != ap.node_counts.end())
+            throw ArgException("The numbers of nodes must be positive integers", "nodes");
+
+        return ap;
+
+    } catch (ArgException &e) {  // catch any exceptions
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+        exit(-1);
+    } catch (std::invalid_argument &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        exit(-1);
+    }
+}
+
+
+// Helper function to read the parameters of a huge page benchmark from a command line
+HugePagesParams readHugePagesParams(int argc, char **argv){
+    using namespace boost::lambda;
+    using namespace TCLAP;
+
+    try {
+        CmdLine cmd("HL-Hitters huge page benchmark in C++", ' ', "0.3");
+
+        PredicateConstraint<uint> posIntConstraint(_1>0, "A positive integer");
+        ValueArg<uint> numArg("n", "numexec", "Number of repetitions of each configuration (default=3)", false, 3, &posIntConstraint);
+        cmd.add( numArg );
+
+        ValueArg<uint> rngArg("r", "rng", "Seed to use for the random number generator (default=1)", false, 1, &posIntConstraint);
+        cmd.add( rngArg );
+
+        ValueArg<uint> kArg("k", "k", "Number of heaviest hitters to query (default=1)", false, 1, &posIntConstraint);
+        cmd.add( kArg );
+
+        std::vector<std::string> allowedAlgorithmsStr = algorithmNames();
+        ValuesConstraint<std::string> allowedAlgorithmsConstraint( allowedAlgorithmsStr );
+        ValueArg<std::string> algArg("a", "alg", "Algorithm to use, only the queue takes huge pages with the algorithms other than hlhitters and hierarchical (default=hlhitters)",
+                                     false, "hlhitters", &allowedAlgorithmsConstraint);
+        cmd.add( algArg );
+
+        ValueArg<std::string> queueArg("q", "queue", "Maximum queue sizes in items, comma separated values and from:to[:step] ranges (default=100000,1000000)", false, "100000,1000000", "list");
+        cmd.add( queueArg );
+
+        ValueArg<uint> flowsArg("f", "flows", "Number of flows to use (default=1000000)", false, 1000000, &posIntConstraint);
+        cmd.add( flowsArg );
+
+        ValueArg<uint> seqArg("s", "seqsize", "Number of items to process (default=5000000)", false, 5000000, &posIntConstraint);
+        cmd.add( seqArg );
+
+        ValueArg<std::string> hugeArg("H", "huge", "Huge page sizes to compare with the normal pages, comma separated 2m and 1g (default=2m,1g)", false, "2m,1g", "list");
+        cmd.add( hugeArg );
+
+        ValueArg<int> numaArg("U", "numa", "NUMA node to bind the huge pages to, -1 for the node of the thread using them (default=-1)", false, -1, "int");
+        cmd.add( numaArg );
+
+        cmd.parse( argc, argv );
+
+        HugePagesParams hp;
+        hp.params.seq_size = seqArg.getValue();
+        hp.params.flow_count = flowsArg.getValue();
+        hp.params.alg_type = algorithmType(algArg.getValue());
+        hp.params.k_heaviest = kArg.getValue();
+        hp.params.random_seed = rngArg.getValue();
+        hp.params.numa_node = numaArg.getValue();
+        hp.queue_sizes = ParseUintList(queueArg.getValue());
+        hp.times = numArg.getValue();
+        if(hp.queue_sizes.empty() || std::find(hp.queue_sizes.begin(), hp.queue_sizes.end(), 0) != hp.queue_sizes.end())
+            throw ArgException("The queue sizes must be positive integers", "queue");
+        std::stringstream sizes(hugeArg.getValue());
+        std::string size;
+        while(std::getline(sizes, size, ',')){
+            if(pageSize(size) == 0)
+                throw ArgException("Unknown huge page size '" + size + "'", "huge");
+            hp.page_sizes.push_back(pageSize(size));
+        }
+
+        return hp;
+
+    } catch (ArgException &e) {  // catch any exceptions
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+        exit(-1);
+    } catch (std::invalid_argument &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        exit(-1);
+    }
+}
 
 #endif /* COMMANDLINE_H_ */
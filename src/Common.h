@@ -47,8 +47,8 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 typedef unsigned int uint; // To avoid signed/unsigned comparison warnings, we never actually need signed ints
 
 // Print lists
-template <class T>
-std::ostream& operator<< (std::ostream &out, std::list<T> &l){
+template <class T, class A>
+std::ostream& operator<< (std::ostream &out, std::list<T, A> &l){
     out << "L(" << l.size() << "): ";
     foreach(T & t, l)
         out << t << " <-> ";
@@ -57,8 +57,8 @@ std::ostream& operator<< (std::ostream &out, std::list<T> &l){
 }
 
 // Print vectors
-template <class T>
-std::ostream& operator<< (std::ostream &out, std::vector<T> &v){
+template <class T, class A>
+std::ostream& operator<< (std::ostream &out, std::vector<T, A> &v){
     out << "V(" << v.size() << "): ";
     uint i=0;
     foreach(T & t, v){
@@ -84,10 +84,10 @@ std::ostream& operator<< (std::ostream &out, std::deque<T> &d){
 
 
 // Print unordered (hash tabled based) maps
-template <class K, class V>
-std::ostream& operator<< (std::ostream &out, boost::unordered_map<K,V> &m){
+template <class K, class V, class H, class P, class A>
+std::ostream& operator<< (std::ostream &out, boost::unordered_map<K,V,H,P,A> &m){
     out << "M(" << m.size() << "): ";
-    typename boost::unordered_map<K,V>::iterator it = m.begin();
+    typename boost::unordered_map<K,V,H,P,A>::iterator it = m.begin();
     for(; it!=m.end(); ++it)
         out << *it <<", ";
     out << "End";
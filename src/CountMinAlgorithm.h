@@ -0,0 +1,300 @@
+/*
+CountMinAlgorithm.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COUNTMINALGORITHM_H_
+#define COUNTMINALGORITHM_H_
+
+#include "Common.h"
+#include "Algorithm.h"
+
+#include <set>
+#include <limits>
+#include <cmath>
+#include <stdint.h>
+
+// The sizing of an approximate algorithm
+struct SketchConfig{
+    double epsilon;  // The count error bound as a fraction of the window: an estimate exceeds the count by at most epsilon*window
+    double delta;  // The probability that an estimate exceeds the error bound
+    uint64_t memory_budget;  // When positive, the bytes to size the sketch and the candidates by, overriding epsilon
+    uint candidates;  // The number of heavy flow candidates kept, 0 for ceil(1/epsilon) or a quarter of the memory budget
+
+    SketchConfig()
+    :epsilon(0.001), delta(0.01), memory_budget(0), candidates(0) {}
+};
+
+// Helper function for printing
+std::ostream& operator<< (std::ostream &out, const SketchConfig &c){
+    out << "Epsilon:" << c.epsilon << ", Delta:" << c.delta;
+    if(c.memory_budget > 0)
+        out << ", MemoryBudget:" << c.memory_budget;
+    if(c.candidates > 0)
+        out << ", Candidates:" << c.candidates;
+    return out;
+}
+
+
+// Approximate Heaviest Hitters algorithm in bounded memory: a Count-Min sketch of the window with a set of heavy flow candidates.
+// The sketch counts every flow in depth rows of width counters, and supports the decrements of Expire exactly, so an estimate
+// is never below the flow's count and exceeds it by at most epsilon*window with probability 1-delta. Only the candidates,
+// the flows with the highest estimates seen at their last update, are kept, so the memory is independent of the number of flows.
+class CountMinAlgorithm : public Algorithm {
+protected:
+    typedef std::vector<uint32_t, TrackingAllocator<uint32_t> > CounterVector;  // The counters, row after row
+    typedef std::pair<uint, FlowP> EstimateFlowPair;  // A candidate's estimate and flow
+    typedef std::set<EstimateFlowPair, std::less<EstimateFlowPair>, TrackingAllocator<EstimateFlowPair> > CandidateSet;  // The candidates, lightest first
+
+    static const uint candidate_bytes = 96;  // The approximate memory of a candidate, a map entry and a set node, used with a memory budget
+
+    AllocationStats memory;  // The memory usage of the sketch and the candidates, recorded when tracking is enabled
+    bool track_memory;  // Whether the memory usage and the operations are recorded
+
+    uint width_bits;  // The width of a row is 2^width_bits counters
+    uint depth;  // The number of rows
+    uint capacity;  // The maximum number of candidates
+    std::vector<uint64_t> hash_a, hash_b;  // The multiply-shift hash function of each row
+    CounterVector counters;  // The sketch
+
+    FlowCountMap candidate_estimates;  // The estimate of each candidate at its last update
+    CandidateSet candidates;  // The candidates ordered by that estimate
+
+    uint total_count;  // The number of packets counted
+
+public:
+    // Constructor, sizes the sketch and the candidates by config. track_memory enables recording their memory usage.
+    CountMinAlgorithm(const SketchConfig & config = SketchConfig(), bool track_memory = false)
+    :track_memory(track_memory), counters(CounterVector::allocator_type(track_memory ? &memory : NULL)),
+     candidate_estimates(FlowCountMap::allocator_type(track_memory ? &memory : NULL)),
+     candidates(CandidateSet::key_compare(), CandidateSet::allocator_type(track_memory ? &memory : NULL)),
+     total_count(0)
+    {
+        depth = std::max(1, (int)std::ceil(std::log(1.0 / config.delta)));
+        if(config.candidates > 0)
+            capacity = config.candidates;
+        else if(config.memory_budget > 0)  // A quarter of the budget goes to the candidates
+            capacity = std::max<uint64_t>(1, config.memory_budget / 4 / candidate_bytes);
+        else
+            capacity = (uint)std::ceil(1.0 / config.epsilon);
+        if(config.memory_budget > 0){  // The counters get what the candidates leave, rounded down to a power of two per row
+            uint64_t row_bytes = (config.memory_budget > (uint64_t)capacity * candidate_bytes)
+                                 ? (config.memory_budget - (uint64_t)capacity * candidate_bytes) / depth : 0;
+            for(width_bits = 0; (sizeof(uint32_t) << (width_bits + 1)) <= row_bytes && width_bits < 31; ++width_bits) {}
+        }else  // The width is e/epsilon, rounded up to a power of two
+            for(width_bits = 0; (double)(1u << width_bits) < std::exp(1.0) / config.epsilon && width_bits < 31; ++width_bits) {}
+
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;  // A fixed seed, so that the runs are repeatable and the packet generator's RNG is untouched
+        for(uint i=0; i<depth; ++i){
+            hash_a.push_back(SplitMix64(seed) | 1);  // Multiply-shift needs an odd multiplier
+            hash_b.push_back(SplitMix64(seed));
+        }
+        counters.assign((std::size_t)depth << width_bits, 0);
+        candidate_estimates.rehash(capacity);
+
+        memory.EndSetup();
+    }
+
+    // Executed when a new item is received
+    virtual void Append(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count++;
+        uint estimate = UpdateSketch(packet.flowp, 1);
+        UpdateCandidate(packet.flowp, estimate);
+    }
+
+    // Executed when an item is served
+    virtual void Expire(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count--;
+        uint estimate = UpdateSketch(packet.flowp, -1);
+        FlowCountMap::iterator it = candidate_estimates.find(packet.flowp);
+        if(it != candidate_estimates.end())  // Only a candidate's estimate matters, a lighter flow cannot displace another on expiry
+            UpdateCandidate(packet.flowp, estimate);
+    }
+
+    // Returns the memory usage of the sketch and the candidates
+    virtual AllocationStats MemoryStats(){
+        return memory;
+    }
+
+    // Returns false, the counts are estimates
+    virtual bool IsExact(){
+        return false;
+    }
+
+    // Returns the count error bound of the sketch as a fraction of the window, e/width
+    double Epsilon() const {
+        return std::exp(1.0) / (1u << width_bits);
+    }
+
+    // Calculates and returns the k candidates with the highest estimates in the provided result container
+    virtual void QueryHeaviest(uint k, HittersQueryResult & result){
+        CandidateSet::reverse_iterator it = candidates.rbegin();
+        for(uint i=0; i<k && it!=candidates.rend(); ++it, ++i)
+            result.push_back(FlowCountPair(it->second, it->first));
+    }
+
+    // Writes the candidates with an estimate of at least c, heaviest first, into result (at most max_results) and returns their number
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results){
+        uint n = 0;
+        for(CandidateSet::reverse_iterator it = candidates.rbegin(); n<max_results && it!=candidates.rend() && it->first>=c; ++it, ++n)
+            result[n] = FlowCountPair(it->second, it->first);
+        return n;
+    }
+
+    // Returns the number of packets currently counted, which is exact
+    virtual uint TotalCount(){
+        return total_count;
+    }
+
+    // Returns the estimated count of any flow
+    virtual uint GetCount(FlowP flowp){
+        uint estimate = std::numeric_limits<uint>::max();
+        for(uint i=0; i<depth; ++i)
+            estimate = std::min(estimate, (uint)counters[Cell(i, flowp)]);
+        return estimate;
+    }
+
+    // Returns 1 + the number of candidates with a higher estimate than flowp, 0 if its estimate is 0
+    virtual uint Rank(FlowP flowp){
+        uint estimate = GetCount(flowp);
+        if(estimate == 0)
+            return 0;
+        return 1 + std::distance(candidates.lower_bound(EstimateFlowPair(estimate + 1, NULL)), candidates.end());
+    }
+
+    // The flow size distribution queries cover the candidates only
+
+    // Returns the number of candidates at each estimate in the provided result container
+    virtual void QueryHistogram(FlowSizeHistogram & result){
+        foreach(const EstimateFlowPair & ef, candidates){
+            if(!result.empty() && result.back().first == ef.first)
+                result.back().second++;
+            else
+                result.push_back(CountFlowsPair(ef.first, 1));
+        }
+    }
+
+    // Returns the number of distinct estimates among the candidates
+    virtual uint DistinctCounts(){
+        FlowSizeHistogram histogram;
+        QueryHistogram(histogram);
+        return histogram.size();
+    }
+
+    // Returns the estimate of the candidate at position ceil(q*candidates) in increasing order, 0 if there are none
+    virtual uint FlowSizeQuantile(double q){
+        if(candidates.empty())
+            return 0;
+        CandidateSet::iterator it = candidates.begin();
+        std::advance(it, QuantilePosition(q, candidates.size()) - 1);
+        return it->first;
+    }
+
+    // Returns the Shannon entropy in bits of the estimates of the candidates, out of the packets counted
+    virtual double FlowSizeEntropy(){
+        double entropy = 0.0;
+        foreach(const EstimateFlowPair & ef, candidates)
+            entropy += EntropyTerm(ef.first, 1, total_count);  // An estimate is at most the packets counted
+        return entropy;
+    }
+
+    // Zeroes the sketch and forgets the candidates, keeping the same hash functions: O(depth*width)
+    virtual bool Reset(){
+        std::fill(counters.begin(), counters.end(), 0);
+        candidate_estimates.clear();
+        candidates.clear();
+        total_count = 0;
+        memory.Restart();
+        return true;
+    }
+
+    // Rebuilds the sketch and the candidates from n flows, heaviest first, on an empty algorithm: O(n*depth)
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        if(total_count != 0)
+            return false;
+        for(uint i=0; i<n; ++i){
+            if(flows[i].second == 0)
+                return false;
+            UpdateSketch(flows[i].first, flows[i].second);
+            total_count += flows[i].second;
+        }
+        for(uint i=0; i<n; ++i)  // The estimates are final once every flow is in the sketch
+            UpdateCandidate(flows[i].first, GetCount(flows[i].first));
+        return true;
+    }
+
+protected:
+    // Returns the next value of the SplitMix64 generator
+    static uint64_t SplitMix64(uint64_t & state){
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Returns the index of the counter of a flow in row i. Flows are hashed by id, which is the same on every node.
+    std::size_t Cell(uint i, FlowP flowp) const {
+        uint64_t h = (width_bits > 0) ? (hash_a[i] * flowp->id + hash_b[i]) >> (64 - width_bits) : 0;
+        return ((std::size_t)i << width_bits) + h;
+    }
+
+    // Adds delta to the counters of a flow and returns its new estimate
+    uint UpdateSketch(FlowP flowp, int delta){
+        uint estimate = std::numeric_limits<uint>::max();
+        for(uint i=0; i<depth; ++i){
+            uint32_t & c = counters[Cell(i, flowp)];
+            c += delta;
+            estimate = std::min(estimate, (uint)c);
+        }
+        return estimate;
+    }
+
+    // Records the new estimate of a flow among the candidates. A flow which is not a candidate
+    // becomes one if there is room or if it is heavier than the lightest candidate, which it replaces.
+    void UpdateCandidate(FlowP flowp, uint estimate){
+        FlowCountMap::iterator it = candidate_estimates.find(flowp);
+        if(it != candidate_estimates.end()){
+            candidates.erase(EstimateFlowPair(it->second, flowp));
+            if(estimate == 0){
+                candidate_estimates.erase(it);
+                return;
+            }
+            it->second = estimate;
+            candidates.insert(EstimateFlowPair(estimate, flowp));
+            return;
+        }
+        if(estimate == 0 || capacity == 0)
+            return;
+        if(candidates.size() >= capacity){
+            CandidateSet::iterator lightest = candidates.begin();
+            if(lightest->first >= estimate)
+                return;
+            candidate_estimates.erase(lightest->second);
+            candidates.erase(lightest);
+        }
+        candidate_estimates.insert(FlowCountPair(flowp, estimate));
+        candidates.insert(EstimateFlowPair(estimate, flowp));
+    }
+};
+
+#endif /* COUNTMINALGORITHM_H_ */
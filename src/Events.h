@@ -0,0 +1,55 @@
+/*
+Events.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include "Common.h"
+#include "Network.h"
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+// A change in the heaviest hitters, emitted by an algorithm to its subscriber
+struct HittersEvent{
+    // ENTER_TOPK/LEAVE_TOPK when a flow enters or leaves the top-k
+    // ABOVE_THRESHOLD when a flow's count rises to the threshold, BELOW_THRESHOLD when it falls under it
+    enum Type {ENTER_TOPK, LEAVE_TOPK, ABOVE_THRESHOLD, BELOW_THRESHOLD};
+
+    Type type;  // What changed
+    FlowP flowp;  // The flow that changed
+    uint count;  // The flow's count after the change
+
+    HittersEvent() {}
+    HittersEvent(Type type, FlowP flowp, uint count)
+    :type(type), flowp(flowp), count(count) {}
+};
+
+// A lock-free single producer (the algorithm) single consumer queue of events
+typedef boost::lockfree::spsc_queue<HittersEvent> HittersEventQueue;
+
+// Helper function for printing
+std::ostream& operator<< (std::ostream &out, const HittersEvent &e){
+    const char * names[] = {"Enter", "Leave", "Above", "Below"};
+    out << "E[" << names[e.type] << ", " << *(e.flowp) << ", " << e.count << "]";
+    return out;
+}
+
+#endif /* EVENTS_H_ */
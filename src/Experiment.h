@@ -28,7 +28,22 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 #include "Algorithm.h"
 #include "BruteForceAlgorithm.h"
 #include "HLHittersAlgorithm.h"
+#include "HeapAlgorithm.h"
+#include "OrderStatisticsAlgorithm.h"
+#include "StreamSummaryAlgorithm.h"
+#include "CountMinAlgorithm.h"
+#include "HierarchicalAlgorithm.h"
+#include "SmallHLHittersAlgorithm.h"
+#include "PcapTrace.h"
+#include "OpLog.h"
 #include "Timer.h"
+#include "Events.h"
+#include "Checkpoint.h"
+#include "AsyncValidator.h"
+
+#include <boost/unordered_set.hpp>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
 
 class Validator;
 
@@ -39,7 +54,26 @@ public:
     // NOPROCESSING performs no heaviest hitter processing - used to calculate the overhead of the packets just passing through the queue
     // BRUTEFORCE uses a simple direct counting method rather inefficient
     // HLHITTERS used the proposed HL-Hitters data structure and associated algorithm
-    enum AlgorithmType {NOPROCESSING, BRUTEFORCE, HLHITTERS};
+    // HEAP keeps the flows in an indexed binary max-heap on their counts
+    // ORDERSTATISTICS keeps the flows in an order statistics tree sorted on their counts
+    // STREAMSUMMARY uses the Stream-Summary buckets of Space-Saving, adapted to decrements
+    // COUNTMIN estimates the counts with a Count-Min sketch in bounded memory, approximately
+    // HIERARCHICAL uses HL-Hitters for the flows and for each level of source address prefixes
+    // SMALLHLHITTERS uses HL-Hitters specialized at compile time for queues of at most 64 packets, HLHITTERS for larger queues
+    enum AlgorithmType {NOPROCESSING, BRUTEFORCE, HLHITTERS, HEAP, ORDERSTATISTICS, STREAMSUMMARY, COUNTMIN, HIERARCHICAL, SMALLHLHITTERS};
+
+    // the formats of the results printed by RunExperiment
+    // TEXT is a single human readable line per experiment
+    // CSV and JSON (JSON Lines) have one row per repetition with every parameter, host and build information and derived rates
+    enum OutputFormat {TEXT, CSV, JSON};
+
+    // the schedules of the heaviest hitter queries
+    // QUERY_PACKET queries after every appended packet
+    // QUERY_EVERY queries after every query_interval appended packets
+    // QUERY_PERIOD queries after the first appended packet once query_interval microseconds have passed since the last query
+    // QUERY_THREAD queries every query_interval microseconds from a separate thread, the updates and queries take turns on a mutex
+    // QUERY_NONE never queries, the algorithm is only updated
+    enum QueryMode {QUERY_PACKET, QUERY_EVERY, QUERY_PERIOD, QUERY_THREAD, QUERY_NONE};
 
     // The Experiment needs a large number of input parameters which have been grouped into this struct
     struct Params{
@@ -51,6 +85,43 @@ public:
         uint random_seed;  // The seed to the random number generator
         AlgorithmType alg_type;  // The algorithm type to use (see AlgorithmType enum)
         bool validation;  // Whether to validate the results by running in parallel to the HL-Hitters algorithm a BruteForce instance and check at each step the results against each other.
+        uint validation_threads;  // When validating and positive, the number of threads to validate on instead of inline (see AsyncValidator)
+        uint validation_sample;  // When validating, validate every validation_sample-th step only, BruteForce is still updated at every step
+        bool check;  // Whether HL-Hitters checks its invariants around the touched nodes after each update (hlhitters and hierarchical only)
+        std::string trace_file;  // A pcap/pcapng file whose packets are replayed instead of generating them uniformly (empty for none)
+        std::string oplog_file;  // A file to record the algorithm's operations into, for replay with HL-Hitters-Replay (empty for none)
+        OutputFormat output_format;  // The format of the results printed by RunExperiment
+        bool memory_stats;  // Whether to record and print the memory usage of the algorithm's data structure
+        double phi;  // When positive, also query every flow holding more than this fraction of the queue after each append
+        bool notify;  // Whether to subscribe to top-k change notifications instead of querying after each append (hlhitters only)
+        uint threshold;  // When notifying and positive, also notify when a flow's count crosses this threshold
+        QueryMode query_mode;  // When to run the heaviest hitter queries (see QueryMode enum)
+        uint query_interval;  // The number of packets (QUERY_EVERY) or microseconds (QUERY_PERIOD, QUERY_THREAD) between queries
+        std::string checkpoint_file;  // A file to save the queue and algorithm state into once the queue is in its steady state (empty for none)
+        std::string restore_file;  // A checkpoint file to start from, with its queue and algorithm state, instead of an empty queue (empty for none)
+        SketchConfig sketch;  // The sizing of the approximate algorithms
+        std::vector<uint> prefix_lengths;  // The source address prefix levels of the hierarchical algorithm, in increasing order
+        std::vector<AlgorithmType> tee;  // When not empty, the algorithms a TeeExperiment feeds the same packets to, instead of alg_type
+        uint tee_slice;  // The number of queue operations each algorithm of a TeeExperiment runs in turn
+        bool pipeline;  // Whether to run the generator, the queue and the algorithm on separate threads (see PipelineExperiment)
+        uint pipeline_batch;  // The number of items the pipeline stages write and read at a time
+        std::vector<uint> pipeline_cores;  // The cores to pin the generator, the queue and the algorithm stages to (empty for none)
+        std::size_t huge_pages;  // The huge page size to back the queue and the HL-Hitters structures with, 0 for the normal pages
+        int numa_node;  // The NUMA node to bind the huge pages to, -1 for the node of the thread using them
+        std::vector<uint> resize_sizes;  // The queue sizes to resize the queue to in turn during the run (empty for none)
+        uint resize_every;  // The number of packets appended between resizes
+
+        // Constructor, sets the same defaults as the command line
+        Params()
+        :number(1), seq_size(10000), flow_count(100), max_queue_size(50), k_heaviest(1), random_seed(1),
+         alg_type(NOPROCESSING), validation(false), validation_threads(0), validation_sample(1), check(false), output_format(TEXT), memory_stats(false), phi(0.0), notify(false), threshold(0),
+         query_mode(QUERY_PACKET), query_interval(1000), tee_slice(1024), pipeline(false), pipeline_batch(64),
+         huge_pages(0), numa_node(-1), resize_every(10000)
+        {
+            prefix_lengths.push_back(16);
+            prefix_lengths.push_back(24);
+            prefix_lengths.push_back(32);
+        }
     };
 
     // Helper functions for printing
@@ -60,6 +131,30 @@ public:
         case NOPROCESSING: return "NoProcessing";
         case BRUTEFORCE:  return "BruteForce";
         case HLHITTERS:  return "HL-Hitters";
+        case HEAP:  return "Heap";
+        case ORDERSTATISTICS:  return "OrderStatistics";
+        case STREAMSUMMARY:  return "StreamSummary";
+        case COUNTMIN:  return "CountMin";
+        case HIERARCHICAL:  return "Hierarchical";
+        case SMALLHLHITTERS:  return "Small-HL-Hitters";
+        default: return "";
+        }
+    }
+    static std::string PageSizeStr(std::size_t page_size){
+        switch (page_size){
+        case 0: return "none";
+        case HugePageArena::page_2m: return "2m";
+        case HugePageArena::page_1g: return "1g";
+        default: return "";
+        }
+    }
+    static std::string QueryModeStr(QueryMode mode){
+        switch (mode){
+        case QUERY_PACKET: return "packet";
+        case QUERY_EVERY:  return "every";
+        case QUERY_PERIOD:  return "period";
+        case QUERY_THREAD:  return "thread";
+        case QUERY_NONE:  return "none";
         default: return "";
         }
     }
@@ -67,15 +162,45 @@ public:
 protected:
     Experiment::Params params;  // The parameters to the experiment
     uint iteration;  // The current iteration number
+    uint packets;  // The number of packets appended so far
     std::vector<Flow> flows;  // A vector of the flow objects
-    MaxQueue<Packet> queue;  // The queue in the router
+    PcapTrace * trace;  // The replayed trace, NULL when packets are generated uniformly
+    HugePageArena queue_arena;  // The huge pages of the queue when Params::huge_pages is set, declared first to outlive it
+    HugePageArena algorithm_arena;  // The huge pages of the algorithm when Params::huge_pages is set
+    PacketQueue queue;  // The queue in the router
     Algorithm * algorithm;  // The selected algorithm
+    OpLogWriter * oplog;  // Records the algorithm's operations, NULL when not recording
 
 
     // A of FlowP-Count Pairs used in AppendPacket().
     // Kept at class level to amortize initialization/allocation costs
     HittersQueryResult results;
 
+    // Receives the flows above the phi threshold in AppendPacket(), sized for every flow so the query never truncates
+    std::vector<FlowCountPair> above;
+
+    // The prefix hierarchy of the hierarchical algorithm, NULL for the other algorithms
+    HierarchicalAlgorithm * hierarchy;
+    std::vector<HittersQueryResult> level_results;  // The drill down results of Query()
+
+    // Change notifications from the algorithm, NULL when not subscribed
+    HittersEventQueue * events;
+    boost::unordered_set<FlowP> notified_topk;  // The top-k flows, as told by the notifications
+    boost::unordered_set<FlowP> notified_above;  // The flows at or above the threshold, as told by the notifications
+
+    // Query scheduling
+    LatencyRecorder latency;  // The latencies of the heaviest hitter queries
+    uint64_t next_query_ns;  // The time of the next query in QUERY_PERIOD mode
+    boost::thread * query_thread;  // The query thread in QUERY_THREAD mode, NULL otherwise
+    boost::mutex algorithm_mutex;  // Taken by the updates and the query thread in QUERY_THREAD mode
+    boost::atomic<bool> stop_queries;  // Tells the query thread to stop
+
+    uint next_resize;  // The index of the next size in Params::resize_sizes
+    uint resizes;  // The number of times the queue was resized
+
+    double checkpoint_seconds;  // The time taken to save the checkpoint, 0 if none was saved
+    double restore_seconds;  // The time taken to restore the checkpoint, 0 if none was restored
+
     // A class which handles the validation of the results in the experiment
     class Validator{
     private:
@@ -87,8 +212,14 @@ protected:
         HittersQueryResult valid_results;
         HittersQueryResult checked_results;
 
+        // Two histograms used in Validate(), kept at class level for the same reason
+        FlowSizeHistogram valid_histogram;
+        FlowSizeHistogram checked_histogram;
+
         uint flow_count;
 
+        AccuracyStats accuracy;  // The accuracy of an approximate algorithm, which is measured instead of validated
+
         typedef HittersQueryResult::iterator HittersQueryResultIt;
 
         // Compares FlowCount pairs, first by count, then by flow id
@@ -137,8 +268,16 @@ protected:
             valid_results.reserve(flow_count);  // Reserve memory
             checked_results.reserve(flow_count);  // Reserve memory
         }
+
+        ~Validator(){
+            delete validator;
+        }
         // Validate the results of HL-Hitters against those of BruteForce
         void Validate(){
+            if(!experiment->algorithm->IsExact()){  // Estimates cannot match, measure how close they are instead
+                MeasureAccuracy();
+                return;
+            }
             valid_results.clear();
             checked_results.clear();
 
@@ -151,6 +290,149 @@ protected:
                 std::cout << "Invalid Results :" << checked_results << std::endl;
                 ::exit(-1);
             }
+
+            ValidateDistribution();
+            if(experiment->hierarchy != NULL)
+                ValidateHierarchy();
+
+            double phi = experiment->GetParams().phi;
+            if(phi > 0){  // Also validate the threshold query
+                valid_results.resize(flow_count);
+                checked_results.resize(flow_count);
+                valid_results.resize(validator->QueryAboveFraction(phi, &valid_results[0], flow_count));
+                checked_results.resize(experiment->algorithm->QueryAboveFraction(phi, &checked_results[0], flow_count));
+                if( valid_results.size() != checked_results.size() || !AreResultsEqual(valid_results, checked_results) ){
+                    std::cout << "At iteration "<< experiment->GetCurrentIteration() << " validation of the phi=" << phi << " threshold query failed!" << std::endl;
+                    std::cout << "Valid Results   :" << valid_results << std::endl;
+                    std::cout << "Invalid Results :" << checked_results << std::endl;
+                    ::exit(-1);
+                }
+            }
+        }
+
+        // Measure the precision and recall of the top-k of an approximate algorithm and the count errors of the reported flows
+        void MeasureAccuracy(){
+            uint k = experiment->GetParams().k_heaviest;
+            checked_results.clear();
+            experiment->algorithm->QueryHeaviest(k, checked_results);
+            accuracy.Record(checked_results, *validator, k);
+        }
+
+        const AccuracyStats & Accuracy() const {
+            return accuracy;
+        }
+
+        // Validate the prefix counts, the heaviest prefixes of every level and the heaviest prefixes within the heaviest one
+        // of the previous level against the counts of BruteForce summed by prefix
+        void ValidateHierarchy(){
+            HierarchicalAlgorithm * h = experiment->hierarchy;
+            uint k = experiment->GetParams().k_heaviest;
+            bool valid = true;
+            uint32_t parent = 0;  // The heaviest prefix of the previous level
+            bool has_parent = false;
+            for(uint l=0; valid && l<h->Levels(); ++l){
+                boost::unordered_map<uint32_t, uint> exact;  // The exact count of every prefix of the level
+                for(FlowCountMap::iterator it = validator->flow_count_dict.begin(); it != validator->flow_count_dict.end(); ++it)
+                    exact[it->first->addr & h->PrefixMask(l)] += it->second;
+
+                std::vector<uint> counts, within_counts;  // The exact counts of the level and of the prefixes within parent, heaviest first
+                for(boost::unordered_map<uint32_t, uint>::iterator it = exact.begin(); it != exact.end(); ++it){
+                    valid = valid && h->PrefixCount(l, it->first) == it->second;
+                    counts.push_back(it->second);
+                    if(has_parent && (it->first & h->PrefixMask(l-1)) == parent)
+                        within_counts.push_back(it->second);
+                }
+                std::sort(counts.rbegin(), counts.rend());
+                std::sort(within_counts.rbegin(), within_counts.rend());
+
+                checked_results.clear();
+                h->QueryPrefixes(l, k, checked_results);
+                valid = valid && checked_results.size() == std::min((std::size_t)k, counts.size());
+                for(uint i=0; valid && i<checked_results.size(); ++i)
+                    valid = checked_results[i].second == counts[i];
+                if(has_parent){
+                    checked_results.clear();
+                    h->QueryWithin(l-1, parent, k, checked_results);
+                    valid = valid && checked_results.size() == std::min((std::size_t)k, within_counts.size());
+                    for(uint i=0; valid && i<checked_results.size(); ++i)
+                        valid = checked_results[i].second == within_counts[i];
+                }
+
+                checked_results.clear();
+                h->QueryPrefixes(l, 1, checked_results);
+                has_parent = !checked_results.empty();
+                if(has_parent)
+                    parent = checked_results[0].first->addr;
+            }
+
+            if(!valid){
+                std::cout << "At iteration "<< experiment->GetCurrentIteration() << " validation of the prefix hierarchy failed!" << std::endl;
+                ::exit(-1);
+            }
+        }
+
+        // Validate the flow size distribution queries of HL-Hitters against those of BruteForce
+        void ValidateDistribution(){
+            Algorithm * checked = experiment->algorithm;
+            valid_histogram.clear();
+            checked_histogram.clear();
+            validator->QueryHistogram(valid_histogram);
+            checked->QueryHistogram(checked_histogram);
+
+            bool valid = (valid_histogram == checked_histogram) && validator->DistinctCounts() == checked->DistinctCounts();
+            const double quantiles[] = {0.0, 0.25, 0.5, 0.9, 1.0};
+            foreach(double q, quantiles)
+                valid = valid && validator->FlowSizeQuantile(q) == checked->FlowSizeQuantile(q);
+            valid = valid && std::fabs(validator->FlowSizeEntropy() - checked->FlowSizeEntropy()) < 1e-9;
+
+            if(!valid){
+                std::cout << "At iteration "<< experiment->GetCurrentIteration() << " validation of the flow size distribution failed!" << std::endl;
+                std::cout << "Valid Distinct/Median/Entropy   :" << validator->DistinctCounts() << "/" << validator->FlowSizeMedian() << "/" << validator->FlowSizeEntropy() << std::endl;
+                std::cout << "Invalid Distinct/Median/Entropy :" << checked->DistinctCounts() << "/" << checked->FlowSizeMedian() << "/" << checked->FlowSizeEntropy() << std::endl;
+                ::exit(-1);
+            }
+        }
+
+        // Validate the sets of flows told by the notifications against the top-k query of HL-Hitters and the threshold query of BruteForce
+        void ValidateNotifications(){
+            Experiment::Params p = experiment->GetParams();
+            checked_results.clear();
+            experiment->algorithm->QueryHeaviest(p.k_heaviest, checked_results);
+            bool valid = (checked_results.size() == experiment->notified_topk.size());
+            foreach(FlowCountPair & fc, checked_results)
+                valid = valid && experiment->notified_topk.count(fc.first);
+
+            if(p.threshold > 0){
+                valid_results.resize(flow_count);
+                valid_results.resize(validator->QueryAboveCount(p.threshold, &valid_results[0], flow_count));
+                valid = valid && (valid_results.size() == experiment->notified_above.size());
+                foreach(FlowCountPair & fc, valid_results)
+                    valid = valid && experiment->notified_above.count(fc.first);
+            }
+
+            if(!valid){
+                std::cout << "At iteration "<< experiment->GetCurrentIteration() << " validation of the notifications failed!" << std::endl;
+                std::cout << "Top-k Results     :" << checked_results << std::endl;
+                std::cout << "Notified Top-k    :" << experiment->notified_topk.size() << " flows" << std::endl;
+                std::cout << "Threshold Results :" << valid_results << std::endl;
+                std::cout << "Notified Above    :" << experiment->notified_above.size() << " flows" << std::endl;
+                ::exit(-1);
+            }
+        }
+
+        // Validate the per-flow queries of HL-Hitters for one flow against those of BruteForce
+        void ValidateFlow(FlowP flowp){
+            if(!experiment->algorithm->IsExact())
+                return;
+            uint k = experiment->GetParams().k_heaviest;
+            Algorithm * checked = experiment->algorithm;
+            if(validator->GetCount(flowp) != checked->GetCount(flowp) || validator->Rank(flowp) != checked->Rank(flowp)
+               || validator->IsInTopK(flowp, k) != checked->IsInTopK(flowp, k)){
+                std::cout << "At iteration "<< experiment->GetCurrentIteration() << " validation of flow " << *flowp << " failed!" << std::endl;
+                std::cout << "Valid Count/Rank/InTopK   :" << validator->GetCount(flowp) << "/" << validator->Rank(flowp) << "/" << validator->IsInTopK(flowp, k) << std::endl;
+                std::cout << "Invalid Count/Rank/InTopK :" << checked->GetCount(flowp) << "/" << checked->Rank(flowp) << "/" << checked->IsInTopK(flowp, k) << std::endl;
+                ::exit(-1);
+            }
         }
 
         void Append(Packet& packet) {
@@ -160,56 +442,227 @@ protected:
         void Expire(Packet& packet) {
             validator->Expire(packet);
         }
+
+        // Starts the BruteForce algorithm from the same state as the queue, returns false if they do not match
+        bool Restore(const FlowCountPair * flows, uint n) {
+            return validator->Restore(flows, n) && validator->TotalCount() == experiment->queue.size();
+        }
     };
 
 
-    Validator * validator;  // The validator object when validation is enabled
+    Validator * validator;  // The validator object when validation is enabled inline
+    AsyncValidator * async_validator;  // The validator object when validation is enabled on other threads
 
 
 public:
     // Constructor, needs the experiment parameters as arguments
-    Experiment(Params p) : params(p), queue(p.max_queue_size)
+    Experiment(Params p)
+    :params(p), queue_arena(ArenaPageSize(p), p.numa_node), algorithm_arena(ArenaPageSize(p), p.numa_node),
+     queue(p.max_queue_size, PacketQueue::allocator_type(NULL, p.huge_pages ? &queue_arena : NULL))
     {
         srand(params.random_seed);  // Initialize RNG with provided seed
         iteration = 0;  // Initialize current iteration
-        for(uint i=1; i<=params.flow_count; ++i) // Create Flow objects
-            flows.push_back(Flow(i));
+        packets = 0;
+        next_query_ns = 0;
+        query_thread = NULL;
+        stop_queries = false;
+        next_resize = resizes = 0;
+        checkpoint_seconds = restore_seconds = 0.0;
 
-        switch (params.alg_type){  // Create Heaviest Hitters algorithm to use
-        case NOPROCESSING: algorithm = new NoProcessingAlgorithm(); break;
-        case BRUTEFORCE: algorithm = new BruteForceAlgorithm; break;
-        case HLHITTERS: algorithm = new HLHittersAlgorithm(params.max_queue_size);
+        if(!params.trace_file.empty()){  // Replay a trace, its flows are discovered from the file
+            trace = new PcapTrace(params.trace_file);
+            params.flow_count = trace->FlowCount();
+        }else{
+            trace = NULL;
+            for(uint i=1; i<=params.flow_count; ++i) // Create Flow objects
+                flows.push_back(Flow(i, SyntheticAddress(i)));
         }
 
+        algorithm = CreateAlgorithm(params.alg_type, params.max_queue_size, params.memory_stats, params,
+                                    params.huge_pages ? &algorithm_arena : NULL);  // Create Heaviest Hitters algorithm to use
+        hierarchy = dynamic_cast<HierarchicalAlgorithm*>(algorithm);
+        if(params.check){  // Enable the invariant checks
+            HLHittersAlgorithm * hlhitters = dynamic_cast<HLHittersAlgorithm*>(algorithm);
+            if(hierarchy != NULL)
+                hierarchy->SetChecking(true);
+            else if(hlhitters != NULL)
+                hlhitters->SetChecking(true);
+            else{
+                std::cout << "Error: Invariant checks are only available for the HL-Hitters and Hierarchical algorithms, not " << AlgTypeStr(params.alg_type) << std::endl;
+                ::exit(-1);
+            }
+        }
+
+        if(!params.oplog_file.empty())  // Check for enabled recording
+            oplog = new OpLogWriter(params.oplog_file, params.flow_count, params.max_queue_size, params.k_heaviest);
+        else
+            oplog = NULL;  // No recording
+
         results.reserve(params.k_heaviest);  // Reserve memory for results
+        if(params.phi > 0)
+            above.resize(params.flow_count);  // Reserve memory for the threshold query results
 
-        if(params.validation){  // Check for enabled validation
+        validator = NULL;
+        async_validator = NULL;
+        if(params.validation && params.validation_threads > 0)  // Check for enabled validation on other threads
+            async_validator = new AsyncValidator(params.validation_threads, params.k_heaviest, params.validation_sample, algorithm->IsExact());
+        else if(params.validation){  // Check for enabled validation
             validator = new Validator(this);  // Create validating BruteForce algorithm
+        }
+
+        if(!params.restore_file.empty())  // Start from a checkpoint
+            RestoreCheckpoint();
+
+        if(params.notify){  // Check for enabled notifications
+            // At most three events per operation, and they are consumed after every operation
+            events = new HittersEventQueue(64);
+            HLHittersAlgorithm * hlhitters = dynamic_cast<HLHittersAlgorithm*>(algorithm);
+            if(hlhitters == NULL){
+                std::cout << "Error: Notifications are only available from the HL-Hitters algorithm, not " << AlgTypeStr(params.alg_type) << std::endl;
+                ::exit(-1);
+            }
+            hlhitters->Subscribe(events, params.k_heaviest, params.threshold);
         }else
-            validator = NULL;  // No validation
+            events = NULL;  // No notifications
+    }
+
+    ~Experiment(){
+        delete events;
+        delete oplog;
+        delete validator;
+        delete async_validator;  // Stops the validation threads
+        delete algorithm;
+        delete trace;
+    }
+
+    // Prepares the experiment for another run with the same parameters, keeping the storage of the queue and the algorithm.
+    // Returns false if it cannot be reused: when replaying a trace, recording, checkpointing, validating or notifying,
+    // or when the algorithm cannot be reset. Then a new experiment must be constructed.
+    bool Reset(){
+        if(trace != NULL || oplog != NULL || !params.checkpoint_file.empty() || !params.restore_file.empty()
+           || validator != NULL || async_validator != NULL || events != NULL || !algorithm->Reset())
+            return false;
+        algorithm->Resize(params.max_queue_size);  // Undo the resizes of the run
+        srand(params.random_seed);
+        iteration = 0;
+        packets = 0;
+        queue.clear();
+        queue.max_queue_size = params.max_queue_size;
+        next_resize = resizes = 0;
+        foreach(Flow & flow, flows)
+            flow.seq_num = 1;
+        latency.Clear();
+        next_query_ns = 0;
+        stop_queries = false;
+        checkpoint_seconds = restore_seconds = 0.0;
+        return true;
     }
 
     // Runs an experiment from start to finish
     void UniformExperiment(){
-        // fill up queue
-        while( queue.size() < params.max_queue_size )
+        if(params.query_mode == QUERY_THREAD && events == NULL)  // Start querying in parallel
+            query_thread = new boost::thread(boost::bind(&Experiment::QueryThread, this));
+
+        Fill();
+        Steady();
+        if(!params.checkpoint_file.empty())  // Save the steady state
+            SaveCheckpoint();
+        Drain();
+
+        if(query_thread != NULL){  // Stop querying
+            stop_queries = true;
+            query_thread->join();
+            delete query_thread;
+            query_thread = NULL;
+        }
+        if(async_validator != NULL)  // Wait for the validation to catch up
+            FinishValidation();
+    }
+
+    // The phases of an experiment, which can also be run separately to stop with a full queue
+
+    // Fills up the queue
+    void Fill(){
+        while( queue.size() < queue.max_queue_size && iteration < params.seq_size ){
             AppendPacket();
+            ScheduledResize();
+        }
+    }
 
-        // keep queue full
-        while( iteration < params.seq_size - params.max_queue_size ){
-            RemovePacket();
+    // Keeps the queue full until the end of the sequence, refilling it when it grows
+    void Steady(){
+        while( iteration + queue.max_queue_size < params.seq_size ){
+            if(queue.size() >= queue.max_queue_size)
+                RemovePacket();
             AppendPacket();
+            ScheduledResize();
         }
+    }
 
-        // empty the queue
+    // Empties the queue
+    void Drain(){
         while( queue.size() > 0 )
             RemovePacket();
     }
 
 
+    // Changes the queue size during the run, as a router changing its buffer size. When it shrinks, the oldest packets
+    // beyond the new size are served at once, which expires them from the algorithm, and then the algorithm is resized.
+    // The algorithm stays queryable throughout.
+    void ResizeQueue(uint max_queue_size){
+        while(queue.size() > max_queue_size)
+            RemovePacket();
+        {
+            boost::unique_lock<boost::mutex> lock(algorithm_mutex, boost::defer_lock);
+            if(query_thread != NULL) lock.lock();  // Take turns with the query thread
+            if(!algorithm->Resize(max_queue_size)){
+                std::cout << "Error: Cannot resize the " << AlgTypeStr(params.alg_type) << " algorithm to a queue size of " << max_queue_size << std::endl;
+                ::exit(-1);
+            }
+        }
+        queue.max_queue_size = max_queue_size;
+        resizes++;
+    }
+
+    // Returns the number of times the queue was resized
+    uint GetResizeCount(){
+        return resizes;
+    }
+
     // Helper function for executing an Experiment multiple times and collecting statistics
     static void RunExperiment(Experiment::Params params, uint times);
 
+    // Returns the mean execution time of the NoProcessing algorithm with the same parameters,
+    // i.e. the overhead of generating and queueing the packets which is subtracted from the algorithms' times
+    static double MeasureBaseline(Experiment::Params params, uint times);
+
+    // Returns the page size of the arenas, which are only used when Params::huge_pages is set
+    static std::size_t ArenaPageSize(const Params & p){
+        return p.huge_pages ? p.huge_pages : (std::size_t)HugePageArena::page_2m;
+    }
+
+    // Creates a Heaviest Hitters algorithm of the given type, optionally recording its memory usage.
+    // The algorithm specific settings (the sketch, the prefix levels) are taken from config.
+    // The HL-Hitters structures take their memory from arena when one is given.
+    static Algorithm * CreateAlgorithm(AlgorithmType alg_type, uint max_queue_size, bool track_memory = false, const Params & config = Params(),
+                                       HugePageArena * arena = NULL){
+        switch (alg_type){
+        case NOPROCESSING: return new NoProcessingAlgorithm();
+        case BRUTEFORCE: return new BruteForceAlgorithm(track_memory);
+        case HLHITTERS: return new HLHittersAlgorithm(max_queue_size, track_memory, arena);
+        case HEAP: return new HeapAlgorithm(track_memory);
+        case ORDERSTATISTICS: return new OrderStatisticsAlgorithm(track_memory);
+        case STREAMSUMMARY: return new StreamSummaryAlgorithm(track_memory);
+        case COUNTMIN: return new CountMinAlgorithm(config.sketch, track_memory);
+        case HIERARCHICAL: return new HierarchicalAlgorithm(max_queue_size, config.prefix_lengths, track_memory, arena);
+        case SMALLHLHITTERS: {  // The specialization is picked by the queue size
+            Algorithm * small = CreateSmallHLHitters(max_queue_size, track_memory);
+            return (small != NULL) ? small : new HLHittersAlgorithm(max_queue_size, track_memory, arena);
+        }
+        default: return NULL;
+        }
+    }
+
     Experiment::Params GetParams(){
         return params;
     }
@@ -218,15 +671,133 @@ public:
         return iteration;
     }
 
+    uint GetPacketCount(){
+        return packets;
+    }
+
     Algorithm * GetCurrentAlgorithm(){
         return algorithm;
     }
 
+    const LatencyRecorder & GetQueryLatency(){
+        return latency;
+    }
+
+    double GetCheckpointSeconds(){
+        return checkpoint_seconds;
+    }
+
+    const HugePageArena & GetQueueArena(){
+        return queue_arena;
+    }
+
+    const HugePageArena & GetAlgorithmArena(){
+        return algorithm_arena;
+    }
+
+    double GetRestoreSeconds(){
+        return restore_seconds;
+    }
+
+    // Returns the measured accuracy of an approximate algorithm, empty unless validating
+    AccuracyStats GetAccuracy(){
+        if(async_validator != NULL)
+            return async_validator->Accuracy();
+        return (validator != NULL) ? validator->Accuracy() : AccuracyStats();
+    }
+
+    // Returns the number of times the updates waited for the validation threads, 0 unless validating on other threads
+    uint64_t GetValidationStalls(){
+        return (async_validator != NULL) ? async_validator->Stalls() : 0;
+    }
+
+    // Waits for the validation threads to validate every step so far, and exits if any validation failed
+    void FinishValidation(){
+        async_validator->Finish();
+        if(async_validator->Failures() > 0){
+            std::cout << "Asynchronous validation failed at " << async_validator->Failures() << " steps!" << std::endl;
+            ::exit(-1);
+        }
+    }
+
+    // Saves the queue and the algorithm state into params.checkpoint_file
+    void SaveCheckpoint(){
+        OneShotTimer timer;
+        timer.Start();
+        WriteCheckpoint(params.checkpoint_file, params.flow_count, queue, *algorithm);
+        timer.Stop();
+        checkpoint_seconds = timer.Duration();
+    }
+
 protected:
 
 
-    // Generate a new packet uniformly
+    // Returns the source address of a generated flow: four flows per host, 16 hosts per /24 and 256 /24s per /16, in 10.0.0.0/8
+    static uint32_t SyntheticAddress(uint id){
+        uint host = (id - 1) / 4;
+        return 0x0A000000u | ((host / 16 % 65536) << 8) | (host % 16 + 1);
+    }
+
+    // Returns the flow with the given id, in [1, flow_count]
+    FlowP GetFlow(uint id){
+        return (trace != NULL) ? trace->GetFlow(id) : &flows[id-1];
+    }
+
+    // Loads the queue and the algorithm state from params.restore_file. The algorithm is rebuilt from the saved state
+    // in O(flows), the packets of the queue are not replayed through it.
+    void RestoreCheckpoint(){
+        OneShotTimer timer;
+        timer.Start();
+        CheckpointReader reader(params.restore_file);
+        const CheckpointHeader & header = reader.Header();
+        if(header.flow_count != params.flow_count || header.max_queue_size != params.max_queue_size){
+            std::cout << "Error: The checkpoint " << params.restore_file << " is of " << header.flow_count << " flows and a queue size of "
+                      << header.max_queue_size << ", not " << params.flow_count << " and " << params.max_queue_size << std::endl;
+            ::exit(-1);
+        }
+
+        const CheckpointPacket * saved = reader.Queue();  // Refill the queue
+        for(uint i=0; i<header.queue_length; ++i){
+            if(saved[i].flow_id < 1 || saved[i].flow_id > params.flow_count)
+                reader.Fail("unknown flow");
+            FlowP flowp = GetFlow(saved[i].flow_id);
+            queue.push_back(Packet(flowp, saved[i].seq_num, saved[i].length));
+            flowp->seq_num = std::max(flowp->seq_num, saved[i].seq_num + 1);  // Continue each flow's sequence
+        }
+
+        SummaryView state = reader.State();  // Rebuild the algorithm
+        std::vector<FlowCountPair> counted(state.Size());
+        for(uint i=0; i<state.Size(); ++i){
+            if(state[i].flow_id < 1 || state[i].flow_id > params.flow_count)
+                reader.Fail("unknown flow");
+            counted[i] = FlowCountPair(GetFlow(state[i].flow_id), state[i].count);
+        }
+        const FlowCountPair * first = counted.empty() ? NULL : &counted[0];
+        if(!algorithm->Restore(first, counted.size())){
+            std::cout << "Error: The " << AlgTypeStr(params.alg_type) << " algorithm cannot be restored from " << params.restore_file << std::endl;
+            ::exit(-1);
+        }
+        if(params.alg_type != NOPROCESSING && algorithm->TotalCount() != queue.size())
+            reader.Fail("the algorithm state does not match the queue");
+        timer.Stop();
+        restore_seconds = timer.Duration();
+
+        if(oplog != NULL)  // Record the restored queue as appended packets, so that the log replays from an empty queue
+            for(uint i=0; i<queue.size(); ++i)
+                oplog->RecordAppend(queue[i]);
+        if(validator != NULL){  // The BruteForce algorithm starts from the same state, which is validated right away
+            if(!validator->Restore(first, counted.size()))
+                reader.Fail("the algorithm state does not match the queue");
+            validator->Validate();
+        }
+        if(async_validator != NULL && !async_validator->Restore(first, counted.size()))
+            reader.Fail("the algorithm state does not match the queue");
+    }
+
+    // Generate a new packet uniformly, or take the next one from the trace
     Packet NextPacket(){
+        if(trace != NULL)
+            return trace->NextPacket();
         Flow& flow = flows[rand()%params.flow_count];
         return flow.NewPacket();
     }
@@ -234,16 +805,115 @@ protected:
     // Append(receive) a new packet to the queue
     void AppendPacket(){
         ++iteration;
+        ++packets;
         Packet packet_in = NextPacket();// Generate a new packet
 
         queue.push_back(packet_in);  // Add it to the queue
-        algorithm->Append(packet_in);  // Run the heaviest hitter Append algorithm to record the new packet
+        {
+            boost::unique_lock<boost::mutex> lock(algorithm_mutex, boost::defer_lock);
+            if(query_thread != NULL) lock.lock();  // Take turns with the query thread
+            algorithm->Append(packet_in);  // Run the heaviest hitter Append algorithm to record the new packet
+        }
+        if(oplog != NULL)  // If recording is enabled
+            oplog->RecordAppend(packet_in);
 
-        algorithm->QueryHeaviest(params.k_heaviest, results);  // Run the heaviest hitter Query algorithm to get the heaviest-k hitters
+        if(events != NULL)  // Consume the changes of the heaviest-k hitters
+            ConsumeEvents();
+        else
+            ScheduledQuery();  // Run the heaviest hitter Query algorithm to get the heaviest-k hitters, when it is time to
+        if(params.phi > 0)  // and the flows above the threshold
+            algorithm->QueryAboveFraction(params.phi, &above[0], above.size());
 
-        if(params.validation){  // If validation is enabled
+        if(validator != NULL){  // If validation is enabled
             validator->Append(packet_in);  // Update the BruteForce algorithm as well
-            validator->Validate();  // and validate
+            if(iteration % params.validation_sample == 0)
+                ValidateStep(packet_in.flowp);  // and validate
+        }else if(async_validator != NULL)  // Validate on the validation threads
+            async_validator->Append(packet_in, iteration, algorithm);
+    }
+
+    // Resizes the queue to the next of the resize sizes every Params::resize_every appended packets
+    void ScheduledResize(){
+        if(params.resize_sizes.empty() || packets % params.resize_every != 0)
+            return;
+        ResizeQueue(params.resize_sizes[next_resize]);
+        next_resize = (next_resize + 1) % params.resize_sizes.size();
+    }
+
+    // Runs the heaviest hitter query if the query schedule says so
+    void ScheduledQuery(){
+        switch(params.query_mode){
+        case QUERY_PACKET:
+            Query();
+            break;
+        case QUERY_EVERY:
+            if(packets % params.query_interval == 0)
+                Query();
+            break;
+        case QUERY_PERIOD:{
+            uint64_t now = LatencyRecorder::Now();
+            if(now >= next_query_ns){
+                Query();
+                next_query_ns = now + params.query_interval * 1000ULL;
+            }
+            break;
+        }
+        default:  // The query thread or nobody queries
+            break;
+        }
+    }
+
+    // Runs the heaviest hitter query. Only the scheduled queries are timed, as only their latency is reported:
+    // the query after every packet is part of the timed run, and reading the clock twice would add to it.
+    void Query(){
+        bool timed = (params.query_mode != QUERY_PACKET);
+        uint64_t start = timed ? LatencyRecorder::Now() : 0;
+        results.clear();
+        algorithm->QueryHeaviest(params.k_heaviest, results);
+        if(hierarchy != NULL)  // and drill down the prefixes
+            hierarchy->QueryDrillDown(params.k_heaviest, level_results);
+        if(timed)
+            latency.Record(LatencyRecorder::Now() - start);
+
+        if(oplog != NULL)  // If recording is enabled
+            oplog->RecordQuery(params.k_heaviest);
+    }
+
+    // The body of the query thread, queries every query_interval microseconds until stopped
+    void QueryThread(){
+        HittersQueryResult thread_results;
+        thread_results.reserve(params.k_heaviest);
+        std::vector<HittersQueryResult> thread_levels;
+        struct timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        while(!stop_queries){
+            next.tv_nsec += params.query_interval % 1000000 * 1000;
+            next.tv_sec += params.query_interval / 1000000 + next.tv_nsec / 1000000000;
+            next.tv_nsec %= 1000000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+            uint64_t start = LatencyRecorder::Now();  // The latency includes waiting for the update in progress
+            {
+                boost::lock_guard<boost::mutex> lock(algorithm_mutex);
+                thread_results.clear();
+                algorithm->QueryHeaviest(params.k_heaviest, thread_results);
+                if(hierarchy != NULL)
+                    hierarchy->QueryDrillDown(params.k_heaviest, thread_levels);
+            }
+            latency.Record(LatencyRecorder::Now() - start);
+        }
+    }
+
+    // Applies the pending change notifications to the notified sets of flows
+    void ConsumeEvents(){
+        HittersEvent e;
+        while(events->pop(e)){
+            switch(e.type){
+            case HittersEvent::ENTER_TOPK: notified_topk.insert(e.flowp); break;
+            case HittersEvent::LEAVE_TOPK: notified_topk.erase(e.flowp); break;
+            case HittersEvent::ABOVE_THRESHOLD: notified_above.insert(e.flowp); break;
+            case HittersEvent::BELOW_THRESHOLD: notified_above.erase(e.flowp); break;
+            }
         }
     }
 
@@ -252,12 +922,31 @@ protected:
         ++iteration;
         Packet packet_out = queue.front();  // Get the to-be-served packet
         queue.pop_front();  // Remove it from the queue
-        algorithm->Expire(packet_out);  // Run the heaviest hitter Expire algorithm to record the new packet
+        {
+            boost::unique_lock<boost::mutex> lock(algorithm_mutex, boost::defer_lock);
+            if(query_thread != NULL) lock.lock();  // Take turns with the query thread
+            algorithm->Expire(packet_out);  // Run the heaviest hitter Expire algorithm to record the new packet
+        }
+        if(events != NULL)  // Consume the changes of the heaviest-k hitters
+            ConsumeEvents();
 
-        if(params.validation){  // If validation is enabled
+        if(oplog != NULL)  // If recording is enabled
+            oplog->RecordExpire(packet_out);
+
+        if(validator != NULL){  // If validation is enabled
             validator->Expire(packet_out);  // Update the BruteForce algorithm as well
-            validator->Validate();  // and validate
-        }
+            if(iteration % params.validation_sample == 0)
+                ValidateStep(packet_out.flowp);  // and validate
+        }else if(async_validator != NULL)  // Validate on the validation threads
+            async_validator->Expire(packet_out, iteration, algorithm);
+    }
+
+    // Validates the algorithm inline after an update of flowp
+    void ValidateStep(FlowP flowp){
+        validator->Validate();
+        validator->ValidateFlow(flowp);
+        if(events != NULL)
+            validator->ValidateNotifications();
     }
 };
 
@@ -266,6 +955,61 @@ std::ostream& operator<< (std::ostream &out, Experiment::Params &p){
     out << "Num:" << p.number << ", SeqSize:" << p.seq_size << ", FlowCount:" << p.flow_count
         << ", QSize:" << p.max_queue_size << ", AlgType:" << Experiment::AlgTypeStr(p.alg_type) << ", K:" << p.k_heaviest
         << ", RngSeed:" << p.random_seed << ", ValidatingResults:" << p.validation;
+    if(p.validation && p.validation_threads > 0)
+        out << ", ValidationThreads:" << p.validation_threads;
+    if(p.validation && p.validation_sample > 1)
+        out << ", ValidationSample:" << p.validation_sample;
+    if(p.memory_stats)
+        out << ", MemoryStats:1";
+    if(p.check)
+        out << ", Check:1";
+    if(p.phi > 0)
+        out << ", Phi:" << p.phi;
+    if(p.notify)
+        out << ", Notify:1, Threshold:" << p.threshold;
+    if(p.query_mode != Experiment::QUERY_PACKET)
+        out << ", Query:" << Experiment::QueryModeStr(p.query_mode) << ", QueryInterval:" << p.query_interval;
+    if(p.alg_type == Experiment::COUNTMIN)
+        out << ", " << p.sketch;
+    if(p.alg_type == Experiment::SMALLHLHITTERS)
+        out << ", SmallCapacity:" << SmallHLHittersCapacity(p.max_queue_size);
+    if(p.alg_type == Experiment::HIERARCHICAL){
+        out << ", Prefixes:";
+        for(uint i=0; i<p.prefix_lengths.size(); ++i)
+            out << (i ? "," : "") << p.prefix_lengths[i];
+    }
+    if(!p.tee.empty()){
+        out << ", Tee:";
+        for(uint i=0; i<p.tee.size(); ++i)
+            out << (i ? "," : "") << Experiment::AlgTypeStr(p.tee[i]);
+        out << ", TeeSlice:" << p.tee_slice;
+    }
+    if(p.pipeline){
+        out << ", Pipeline:1, Batch:" << p.pipeline_batch;
+        if(!p.pipeline_cores.empty()){
+            out << ", Cores:";
+            for(uint i=0; i<p.pipeline_cores.size(); ++i)
+                out << (i ? "," : "") << p.pipeline_cores[i];
+        }
+    }
+    if(!p.resize_sizes.empty()){
+        out << ", Resize:";
+        for(uint i=0; i<p.resize_sizes.size(); ++i)
+            out << (i ? "," : "") << p.resize_sizes[i];
+        out << ", ResizeEvery:" << p.resize_every;
+    }
+    if(p.huge_pages)
+        out << ", HugePages:" << Experiment::PageSizeStr(p.huge_pages);
+    if(p.numa_node >= 0)
+        out << ", NumaNode:" << p.numa_node;
+    if(!p.trace_file.empty())
+        out << ", Trace:" << p.trace_file;
+    if(!p.oplog_file.empty())
+        out << ", OpLog:" << p.oplog_file;
+    if(!p.restore_file.empty())
+        out << ", Restore:" << p.restore_file;
+    if(!p.checkpoint_file.empty())
+        out << ", Checkpoint:" << p.checkpoint_file;
     return out;
 }
 
@@ -276,19 +1020,114 @@ std::ostream& operator<< (std::ostream &out, Experiment &exp){
 }
 
 
+#include "Report.h"  // RunExperiment() writes its machine readable output with ResultWriter
+
 // Helper function for executing an Experiment multiple times and collecting statistics
 void Experiment::RunExperiment(Experiment::Params params, uint times){
     MultiShotTimer timer;  // Create a timer
+    Experiment::Params ran = params;  // The parameters as completed by the experiment (e.g. the flow count of a trace)
+    uint packets = 0;
+    AllocationStats memory;  // The memory usage of the algorithm, identical in every repetition
+    std::vector<LatencyRecorder> latencies;  // The query latencies of each repetition
+    std::vector<double> checkpoint_seconds, restore_seconds;  // The checkpoint and restore times of each repetition
+    std::vector<AccuracyStats> accuracies;  // The accuracy of an approximate algorithm in each repetition
+    std::vector<uint64_t> validation_stalls;  // The waits for the validation threads in each repetition
+    std::vector<uint> resizes;  // The resizes of the queue in each repetition
+    bool exact = true;  // Whether the algorithm's counts are exact
+    Experiment * reused = NULL;  // The experiment of the previous repetition, if it could be reset
     for(uint i = 0; i < times; i++){ // Run multiple experiments
-        Experiment exp(params);  // Create the experiment
+        if(reused == NULL)
+            reused = new Experiment(params);  // Create the experiment
+        Experiment & exp = *reused;
         timer.Start();  // Start timing
         exp.UniformExperiment();  // Run experiment
         timer.Stop();  // Stop timing
+        ran = exp.GetParams();
+        packets = exp.GetPacketCount();
+        memory = exp.GetCurrentAlgorithm()->MemoryStats();
+        latencies.push_back(exp.GetQueryLatency());
+        checkpoint_seconds.push_back(exp.GetCheckpointSeconds());
+        restore_seconds.push_back(exp.GetRestoreSeconds());
+        accuracies.push_back(exp.GetAccuracy());
+        validation_stalls.push_back(exp.GetValidationStalls());
+        resizes.push_back(exp.GetResizeCount());
+        exact = exp.GetCurrentAlgorithm()->IsExact();
+        if(!exp.Reset()){  // Construct the next one anew
+            delete reused;
+            reused = NULL;
+        }
     }
+    delete reused;
 
-    // Print experiment info plus timing info
-    std::cout << "Ran as: " << params << ", ";
-    std::cout << "Execution Time Statistics: " << timer << std::endl;
+    if(params.output_format == TEXT){
+        // Print experiment info plus timing info
+        std::cout << "Ran as: " << ran << ", ";
+        std::cout << "Execution Time Statistics: " << timer;
+        if(params.memory_stats)  // plus memory info
+            std::cout << ", Memory Statistics: " << memory;
+        if(params.query_mode != QUERY_PACKET && !latencies.empty())  // plus the query latencies of the last repetition
+            std::cout << ", Query Latency Statistics: " << latencies.back();
+        if(params.validation && !exact)  // plus the accuracy of the last repetition
+            std::cout << ", Accuracy: " << accuracies.back();
+        if(params.validation && params.validation_threads > 0)  // plus how often the updates waited for the validation
+            std::cout << ", ValidationStalls:" << validation_stalls.back();
+        if(!params.resize_sizes.empty())  // plus how often the queue was resized
+            std::cout << ", Resizes:" << resizes.back();
+        if(!params.restore_file.empty())  // plus the checkpoint times of the last repetition
+            std::cout << ", RestoreSeconds:" << restore_seconds.back();
+        if(!params.checkpoint_file.empty())
+            std::cout << ", CheckpointSeconds:" << checkpoint_seconds.back();
+        std::cout << std::endl;
+        return;
+    }
+
+    // Print one row per repetition, with the NoProcessing baseline subtracted
+    static bool header_written = false;  // The CSV header is printed once, before the first experiment
+    ResultWriter writer(std::cout, params.output_format);
+    if(!header_written){
+        writer.Header();
+        header_written = true;
+    }
+    double baseline = (params.alg_type != NOPROCESSING) ? MeasureBaseline(params, times) : 0.0;
+    for(uint i = 0; i < times; i++){
+        ResultRow row(ran, i+1, timer.Duration(i), packets, baseline, memory);
+        row.latency = latencies[i];
+        row.accuracy = accuracies[i];
+        row.validation_stalls = validation_stalls[i];
+        row.resizes = resizes[i];
+        row.restore_seconds = restore_seconds[i];
+        row.checkpoint_seconds = checkpoint_seconds[i];
+        writer.Row(row);
+    }
+}
+
+// Returns the mean execution time of the NoProcessing algorithm with the same parameters
+double Experiment::MeasureBaseline(Experiment::Params params, uint times){
+    params.alg_type = NOPROCESSING;
+    params.validation = false;
+    params.memory_stats = false;
+    params.oplog_file.clear();
+    params.checkpoint_file.clear();
+    params.check = false;
+    params.notify = false;  // NoProcessing has no notifications to subscribe to
+    params.threshold = 0;
+    if(params.query_mode == QUERY_THREAD)  // NoProcessing queries take no time, the updates alone are the baseline
+        params.query_mode = QUERY_NONE;
+    MultiShotTimer timer;
+    Experiment * reused = NULL;  // Reused like the experiments it is subtracted from
+    for(uint i = 0; i < times; i++){
+        if(reused == NULL)
+            reused = new Experiment(params);
+        timer.Start();
+        reused->UniformExperiment();
+        timer.Stop();
+        if(!reused->Reset()){
+            delete reused;
+            reused = NULL;
+        }
+    }
+    delete reused;
+    return timer.Mean();
 }
 
 
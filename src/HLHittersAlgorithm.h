@@ -25,273 +25,766 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Common.h"
 #include "Algorithm.h"
+#include "Events.h"
 
 // Implements the HL-Hitters data structure and algorithms
 class HLHittersAlgorithm : public Algorithm {
 public:
-    // Used in the FlowCount List as the data element
-    struct FlowCount{
-        FlowP flowp;
-        uint count;
+    typedef uint32_t NodeIndex;  // A node of the count list, its index in the node pool
+    static const NodeIndex sentinel = 0;  // The node which closes the circular count list, in place of an end() iterator
+
+    // A node of the doubly linked count list. The nodes are kept in a pool and linked by 4-byte indices, so a node
+    // is 16 bytes and 4 fit in a cache line. Its flow is kept in a parallel vector, as only the queries need it.
+    struct Node{
+        NodeIndex prev, next;  // The lighter and the heavier neighbouring nodes
+        uint32_t count : 31;  // 0 once the node is released
+        uint32_t in_topk : 1;  // Whether the node is one of the subscribed top-k nodes (the last k of the list)
+        uint32_t range_size;  // The number of nodes in the node's SCR, kept in the SCR's first node only
+
+        Node()
+        :prev(sentinel), next(sentinel), count(0), in_topk(false), range_size(0) {}
     };
-    typedef std::list<FlowCount> FlowCountList;  // the doubly linked list type in the data structure
-    typedef FlowCountList::iterator FlowCountListIt;
-    typedef FlowCountList::reverse_iterator FlowCountListItR;
 
-    // Used in the SameCountRange (SCR) Vector as the type of the vector element
+    // Used in the SameCountRange (SCR) Vector as the type of the vector element. An SCR is the 4-byte indices of its
+    // first and last nodes, 8 bytes, the sentinel when it is empty. Its size is kept in its first node, which the
+    // updates touch anyway, so an update reads a single 8-byte slot of the vector.
     class SameCountRange{
     public:
-        // A pointer to the FlowCountList, used to provide access to the end() iterator as an "Invalid Iterator" marker.
-        // In a traditional Doubly Linked List without iterator we would just use a null pointer value.
-        FlowCountListIt invalid_list_it;
-        FlowCountListIt first_list_it, last_list_it; // The first and last nodes in the same count range. These are inclusive.
+        NodeIndex first_node, last_node; // The first and last nodes in the same count range. These are inclusive.
     public:
 
         // Get the first node in the SCR
-        FlowCountListIt First() const {
-            return first_list_it;
+        NodeIndex First() const {
+            return first_node;
         }
 
         // Get the last node in the SCR
-        FlowCountListIt Last() const {
-            return last_list_it;
+        NodeIndex Last() const {
+            return last_node;
         }
 
-        // Constructor, creates a new SCR. Needs an iterator which it will use as an "Invalid Iterator" marker, the countlist's end().
-        SameCountRange(FlowCountListIt invalid_list_it)
-        :invalid_list_it(invalid_list_it){  Clear();  }
+        // Constructor, creates a new empty SCR
+        SameCountRange()
+        {  Clear();  }
 
         // Returns true if the SCR contains no nodes
         bool Empty() const {
-            return first_list_it==invalid_list_it && last_list_it==invalid_list_it;
+            return first_node==sentinel;
         }
 
         // Returns true if the SCR contains exactly one node
         bool One() const {
-            return !Empty() && first_list_it==last_list_it;
+            return !Empty() && first_node==last_node;
         }
 
         // Clears the SCR. Empty() will return true afterwards.
         void Clear(){
-            first_list_it = last_list_it = invalid_list_it;
+            first_node = last_node = sentinel;
         }
 
 
         // Set the first node in the SCR
-        void SetFirst(FlowCountListIt f){
-            first_list_it = f;
+        void SetFirst(NodeIndex f){
+            first_node = f;
         }
 
         // Set the second node in the SCR
-        void SetLast(FlowCountListIt l){
-            last_list_it = l;
+        void SetLast(NodeIndex l){
+            last_node = l;
         }
 
         // Set both the first and second nodes in the SCR
-        void SetFirstLast(FlowCountListIt f, FlowCountListIt l){
-            first_list_it = f;
-            last_list_it = l;
+        void SetFirstLast(NodeIndex f, NodeIndex l){
+            first_node = f;
+            last_node = l;
         }
-
     };
 protected:
+    // A flow's entry in the FlowMap, stale in the generations after the one it was set in, see Reset()
+    struct FlowEntry{
+        NodeIndex node;  // The flow's count list node
+        uint generation;  // The generation the entry was set in
 
-    typedef std::pair<const FlowP, FlowCountListIt> FlowMapPair;  // The type of element in an FlowMap
-    typedef boost::unordered_map<const FlowP, FlowCountListIt> FlowMap;  // The hash table type in the data structure
+        FlowEntry()
+        :node(sentinel), generation(0) {}
+    };
+    typedef std::pair<const FlowP, FlowEntry> FlowMapPair;  // The type of element in an FlowMap
+    typedef boost::unordered_map<const FlowP, FlowEntry, boost::hash<const FlowP>, std::equal_to<const FlowP>,
+                                 TrackingAllocator<FlowMapPair> > FlowMap;  // The hash table type in the data structure
     typedef FlowMap::iterator FlowMapIt;  // The type of the FlowMap iterator
 
-    typedef std::vector<SameCountRange> SameCountRangeVector; // The vector type in the data structure
+    typedef std::vector<SameCountRange, TrackingAllocator<SameCountRange> > SameCountRangeVector; // The vector type in the data structure
+    typedef std::vector<Node, TrackingAllocator<Node> > NodeVector;  // The node pool
+    typedef std::vector<FlowP, TrackingAllocator<FlowP> > NodeFlowVector;
 
-    const uint max_queue_size;  // The maximum number of elements allowed in the queue
+    uint max_queue_size;  // The maximum number of elements allowed in the queue, see Resize()
+
+    AllocationStats memory;  // The memory usage of the containers, recorded when tracking is enabled
+    bool track_memory;  // Whether the memory usage and the operations are recorded
 
     SameCountRangeVector rangevector;  // The vector in the data structure
-    FlowCountList countlist;  // The doubly linked list in the data structure
+    NodeVector nodes;  // The doubly linked list in the data structure, node 0 is the sentinel
+    NodeFlowVector node_flows;  // The flow of each node
+    NodeIndex free_nodes;  // The released nodes, linked through their next index
+    NodeIndex used_nodes;  // The nodes of the pool ever used, the others are reused only after a Reset()
+    uint list_size;  // The number of nodes in the count list
     FlowMap flowmap;  // The hash table in the data structure
 
+    uint generation;  // The current generation, the flow map entries of the previous ones are stale
+    uint stale_flows;  // The number of stale flow map entries
+
+    uint total_count;  // The sum of the counts in the count list
+    uint distinct_counts;  // The number of non-empty SCRs
+
+    // Change notifications, see Subscribe()
+    HittersEventQueue * events;  // The subscriber's event queue, NULL when there is no subscriber
+    uint topk_k;  // The k of the subscribed top-k, 0 for none
+    uint threshold;  // The subscribed count threshold, 0 for none
+    NodeIndex topk_boundary;  // The lightest top-k node, i.e. the k-th node from the end of the list
+    uint64_t dropped_events;  // The number of events lost because the queue was full
+
+    bool checking;  // Whether the invariants around the touched nodes are checked after each update, see SetChecking()
+
 public:
-    HLHittersAlgorithm(uint max_queue_size)
-    :max_queue_size(max_queue_size)
+    // Constructor, track_memory enables recording the memory usage of the containers.
+    // With an arena the containers take their memory from its huge pages, the arena must outlive the algorithm.
+    HLHittersAlgorithm(uint max_queue_size, bool track_memory = false, HugePageArena * arena = NULL)
+    :max_queue_size(max_queue_size), track_memory(track_memory),
+     rangevector(SameCountRangeVector::allocator_type(track_memory ? &memory : NULL, arena)),
+     nodes(NodeVector::allocator_type(track_memory ? &memory : NULL, arena)),
+     node_flows(NodeFlowVector::allocator_type(track_memory ? &memory : NULL, arena)),
+     free_nodes(sentinel), used_nodes(1), list_size(0),
+     flowmap(FlowMap::allocator_type(track_memory ? &memory : NULL, arena)),
+     generation(0), stale_flows(0), total_count(0), distinct_counts(0),
+     events(NULL), topk_k(0), threshold(0), topk_boundary(sentinel), dropped_events(0), checking(false)
     {
-        rangevector.assign(max_queue_size+1, SameCountRange(countlist.end())); // Initialize the vector
+        rangevector.assign(max_queue_size+1, SameCountRange()); // Initialize the vector
+        nodes.assign(1, Node());  // The sentinel, linked to itself
+        node_flows.assign(1, (FlowP)NULL);
         flowmap.max_load_factor(max_queue_size); // Configure the load factor on the hash table
         flowmap.rehash(max_queue_size);
 
+        memory.EndSetup();
+    }
+
+    // Returns the memory usage of the containers
+    virtual AllocationStats MemoryStats(){
+        return memory;
+    }
+
+    // Subscribes to change notifications, which are pushed into queue during Append and Expire in O(1):
+    // a flow entering or leaving the top-k (the flows QueryHeaviest(k) returns) and a flow's count crossing threshold.
+    // Either k or threshold may be 0 to disable it. Events for the current state are pushed immediately.
+    void Subscribe(HittersEventQueue * queue, uint k, uint count_threshold){
+        events = queue;
+        topk_k = k;
+        threshold = count_threshold;
+        topk_boundary = Begin();
+        uint i = 0;
+        for(NodeIndex cur = Heaviest(); cur != sentinel; cur = nodes[cur].prev, ++i){
+            nodes[cur].in_topk = (i < topk_k);
+            if(nodes[cur].in_topk){
+                Emit(HittersEvent::ENTER_TOPK, node_flows[cur], nodes[cur].count);
+                topk_boundary = cur;
+            }
+            if(threshold > 0 && nodes[cur].count >= threshold)
+                Emit(HittersEvent::ABOVE_THRESHOLD, node_flows[cur], nodes[cur].count);
+        }
+    }
+
+    // Rebuilds the data structure from n flows, heaviest first, on an empty algorithm (before Subscribe).
+    // The flows are appended to the list lightest first, which recreates the same count list order, and each SCR is
+    // extended at its last node, so the restore is O(n) with no sorting and no hash table resizing.
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        if(list_size != 0)
+            return false;
+        for(uint i=n; i-- > 0;){
+            FlowP flowp = flows[i].first;
+            uint count = flows[i].second;
+            if(count == 0 || count > max_queue_size || (list_size != 0 && count < nodes[Heaviest()].count)
+               || FindFlow(flowp) != sentinel)
+                return false;
+
+            NodeIndex node = NewNode(flowp, count);
+            LinkBefore(node, sentinel);
+            SetFlow(flowp, node);
+
+            SameCountRange & scr = LiveRange(count, node);
+            if(scr.Empty()){
+                scr.SetFirstLast(node, node);
+                nodes[node].range_size = 1;
+                distinct_counts++;
+            }else{
+                scr.SetLast(node);
+                nodes[scr.First()].range_size++;
+            }
+            total_count += count;
+        }
+        return total_count <= max_queue_size;
+    }
+
+    // Returns the number of events lost because the subscriber's queue was full
+    uint64_t DroppedEvents() const {
+        return dropped_events;
+    }
+
+    // Enables checking the invariants of the data structure after each Append and Expire, looking only at the touched
+    // nodes and SCRs so that each check is O(1). A violation is reported with the operation number and exits.
+    void SetChecking(bool enable){
+        checking = enable;
+    }
+
+    // Changes the maximum queue size in place, once the packets beyond the new size are expired. The SCR vector grows
+    // or shrinks keeping its capacity, and the flow map only gets more buckets when it grows past them, doubling them,
+    // so the cost is amortized O(1) per packet of the change. The data structure stays queryable throughout.
+    virtual bool Resize(uint new_max_queue_size){
+        if(total_count > new_max_queue_size)
+            return false;
+        rangevector.resize(new_max_queue_size+1, SameCountRange());
+        flowmap.max_load_factor(new_max_queue_size);
+        if(new_max_queue_size > flowmap.bucket_count())
+            flowmap.rehash(std::max<std::size_t>(new_max_queue_size, 2 * flowmap.bucket_count()));
+        max_queue_size = new_max_queue_size;
+        return true;
+    }
+
+    // Empties the data structure in O(1), keeping all its storage: every node of the pool becomes free for reuse,
+    // the flow map entries become stale by starting a new generation, and the SCRs become stale as their nodes are
+    // no longer in use (see LiveRange()), so they are cleared lazily when next used.
+    // A subscriber is not notified, it should forget the flows itself.
+    virtual bool Reset(){
+        if(++generation == 0){  // The generations wrapped around, clear the stale entries for real once
+            flowmap.clear();
+            stale_flows = 0;
+        }else
+            stale_flows = flowmap.size();
+        nodes[sentinel].prev = nodes[sentinel].next = sentinel;
+        free_nodes = sentinel;
+        used_nodes = 1;
+        list_size = 0;
+        total_count = 0;
+        distinct_counts = 0;
+        topk_boundary = sentinel;
+        memory.Restart();
+        return true;
     }
 
 
     // Calculates and returns the k Heaviest Hitters in the provided result container
     virtual void QueryHeaviest(uint k, HittersQueryResult & result){
-        FlowCountListItR cur_count_it=countlist.rbegin();  // Start at the end (the higher counts) of the count list
-        for(uint i=0;i<k && (cur_count_it!=countlist.rend()); ++cur_count_it, ++i){  // and iterate getting flow counts
-            FlowCountPair fc(cur_count_it->flowp, cur_count_it->count);
+        NodeIndex cur = Heaviest();  // Start at the end (the higher counts) of the count list
+        for(uint i=0;i<k && cur!=sentinel; cur=nodes[cur].prev, ++i){  // and iterate getting flow counts
+            FlowCountPair fc(node_flows[cur], (uint)nodes[cur].count);
             result.push_back(fc);
         }
     }
 
+    // Writes the flows with a count of at least c, heaviest first, into result (at most max_results) and returns their number.
+    // The count list is sorted, so walking down from its heaviest node visits exactly the flows returned: O(output).
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results){
+        uint n = 0;
+        NodeIndex cur = Heaviest();
+        for(; n<max_results && cur!=sentinel && nodes[cur].count>=c; cur=nodes[cur].prev, ++n)
+            result[n] = FlowCountPair(node_flows[cur], (uint)nodes[cur].count);
+        return n;
+    }
+
+    // Returns the number of packets currently counted
+    virtual uint TotalCount(){
+        return total_count;
+    }
+
+    // Returns the count of a flow, 0 if it is not counted. A single hash table lookup.
+    virtual uint GetCount(FlowP flowp){
+        NodeIndex node = FindFlow(flowp);
+        return (node != sentinel) ? nodes[node].count : 0;
+    }
+
+    // Returns 1 + the number of flows with a greater count than flowp, 0 if it is not counted.
+    // The heavier flows are the SCRs after the flow's SCR, each adding its range_size, so this is O(distinct heavier counts).
+    virtual uint Rank(FlowP flowp){
+        NodeIndex node = FindFlow(flowp);
+        if(node == sentinel)
+            return 0;
+        uint rank = 1;
+        NodeIndex cur = Next(Range(nodes[node].count).Last());
+        while(cur != sentinel){  // Add the sizes of the heavier SCRs
+            uint count = nodes[cur].count;
+            rank += RangeSize(count);
+            cur = Next(Range(count).Last());
+        }
+        return rank;
+    }
+
+    // Returns true if fewer than k flows have a greater count than flowp.
+    // For the subscribed k this is O(1): at most k-1 flows are heavier than the top-k boundary node, so the flow is
+    // in the top-k exactly when it is at least as heavy as it. For other k the heavier SCRs are walked, adding their
+    // range_size and stopping once k heavier flows are found, which is O(distinct heavier counts).
+    virtual bool IsInTopK(FlowP flowp, uint k){
+        NodeIndex node = FindFlow(flowp);
+        if(node == sentinel || k == 0)
+            return false;
+        if(events != NULL && k == topk_k && topk_boundary != sentinel)
+            return nodes[node].count >= nodes[topk_boundary].count;
+        uint heavier = 0;
+        NodeIndex cur = Next(Range(nodes[node].count).Last());
+        while(cur != sentinel){
+            uint count = nodes[cur].count;
+            heavier += RangeSize(count);
+            if(heavier >= k)
+                return false;
+            cur = Next(Range(count).Last());
+        }
+        return true;
+    }
+
+    // The flow size distribution queries walk the SCRs from the lightest, so they are O(distinct counts)
+
+    // Returns the number of flows at each count in the provided result container
+    virtual void QueryHistogram(FlowSizeHistogram & result){
+        NodeIndex cur = Begin();
+        while(cur != sentinel){
+            uint count = nodes[cur].count;
+            result.push_back(CountFlowsPair(count, RangeSize(count)));
+            cur = Next(Range(count).Last());
+        }
+    }
+
+    // Returns the number of distinct counts among the flows. O(1).
+    virtual uint DistinctCounts(){
+        return distinct_counts;
+    }
+
+    // Returns the count of the flow at position ceil(q*flows) in increasing count order, 0 if no flows are counted
+    virtual uint FlowSizeQuantile(double q){
+        if(list_size == 0)
+            return 0;
+        uint pos = QuantilePosition(q, list_size);
+        uint flows = 0;
+        NodeIndex cur = Begin();
+        while(true){
+            uint count = nodes[cur].count;
+            flows += RangeSize(count);
+            if(flows >= pos)
+                return count;
+            cur = Next(Range(count).Last());
+        }
+    }
+
+    // Returns the Shannon entropy in bits of the distribution of the counted packets over the flows
+    virtual double FlowSizeEntropy(){
+        double entropy = 0.0;
+        NodeIndex cur = Begin();
+        while(cur != sentinel){
+            uint count = nodes[cur].count;
+            entropy += EntropyTerm(count, RangeSize(count), total_count);
+            cur = Next(Range(count).Last());
+        }
+        return entropy;
+    }
+
 
     // Executed when a new item is received
     virtual void Append(Packet & packet)
     {
+        if(track_memory || checking)  // The checks report the operation number
+            memory.operations++;
+        total_count++;
         FlowP flowp = packet.flowp;  // Get the flow of the packet
-        FlowMapIt flowit = flowmap.find(flowp);  // Get an iterator to the flow's entry in the flow map (may fail)
+        NodeIndex node = FindFlow(flowp);  // Get the flow's count list node (may fail)
 
-        FlowCountListIt move_to_it;
-        FlowCount fc;
+        NodeIndex move_to;
+        bool enters_topk = false;  // Whether the flow enters the subscribed top-k
+        bool is_topk_boundary = false;  // Whether the flow's node stays the top-k boundary node
 
-        // If the iterator was valid, the flow was recorded in the map.
-        // We will need to remove the corresponding entry in the count list first.
-        if(flowit != flowmap.end()){
-            FlowCountListIt old_listit = flowit->second;  // Get an iterator the flow's old (before the append) count list node
+        // If the node was valid, the flow was recorded in the map.
+        // We will need to unlink it from its place in the count list first.
+        if(node != sentinel){
+            SameCountRange & old_smc = Range(nodes[node].count);  // Get the old count's corresponding SCR entry
 
-            fc = *old_listit;  // Copy the contents of the count node
-            SameCountRange & old_smc = rangevector[old_listit->count];  // Get the old count's corresponding SCR entry
+            move_to = Next(old_smc.Last());  // Record the list node which is the first in the next valid SCR
+            if(events != NULL)
+                enters_topk = TopKBeforeAppend(node, old_smc.Last(), is_topk_boundary);
 
-            move_to_it = GetNextListIt(old_smc.Last());  // Record the list node which is the first in the next valid SCR
+            RemoveFromRange(node);  // Remove the flow from the same count range it currently is in (old)
+            Unlink(node);  // Take the node out of the list, it is moved rather than reallocated
+        }else{  // The node was not valid, the flow was not recorded in the map. Create a new count list node.
+            move_to = Begin();  // Will be created as the first node in the count list
 
-            RemoveFromRange(old_listit);  // Remove the flow from the same count range it currently is in (old)
-            countlist.erase(old_listit);  // Remove the old count node from the list
-        }else{  // The iterator was not valid, the flow was not recorded in the map. Create a new count list node.
-            move_to_it = countlist.begin();  // Will be created as the first node in the count node
-
-            fc.count = 0;  // Create the flow count
-            fc.flowp = flowp;  // Create the flow count
+            node = NewNode(flowp, 0);
+            SetFlow(flowp, node);  // Set the flow map to point at the new list node
+            enters_topk = (list_size < topk_k);  // All flows are in the top-k while there are fewer than k
         }
 
+        nodes[node].count++;  // Increment count (if newly created, it was 0 upon creation)
+
+        LinkBefore(node, move_to);  // Move the node to its new position in the count list
+        AddToRange(node);  // Update the related SCR element
 
-        fc.count++;  // Increment count (if newly created, it was 0 upon creation)
+        if(events != NULL)
+            TopKAfterAppend(node, enters_topk, is_topk_boundary);
 
-        FlowCountListIt new_listit = countlist.insert(move_to_it, fc);  // Create/move the flow count into a count list node
-        flowmap[flowp] = new_listit;  // Set the flow map to point at the new list node
-        AddToRange(new_listit);  // Update the related SCR element
+        if(checking)
+            CheckUpdate(flowp, nodes[node].count - 1, nodes[node].count);
     }
 
     // Executed when an item is served
     virtual void Expire(Packet& packet){
+        if(track_memory || checking)  // The checks report the operation number
+            memory.operations++;
+        total_count--;
         FlowP flowp = packet.flowp;  // Get the flow of the packet
-        FlowCountListIt old_listit = flowmap[flowp];  // Get an iterator to the flow's entry in the flow map (may fail)
+        NodeIndex node = flowmap[flowp].node;  // Get the flow's count list node
 
-        FlowCount fc= *old_listit;  // Copy the contents of the count node
+        SameCountRange & old_scr = Range(nodes[node].count);  // Get the old count's corresponding SCR entry
 
-        SameCountRange & old_scr = rangevector[old_listit->count];  // Get the old count's corresponding SCR entry
+        NodeIndex first_old_scr = old_scr.First();  // Get the first node in the SCR
+        NodeIndex previous_of_first_old_scr = Prev(first_old_scr);  // and the node which precedes it, the sentinel if it was the first valid SCR
 
-        FlowCountListIt firstit_old_scr = old_scr.First();  // Get an iterator to the first node in the SCR
-        FlowCountListIt previous_of_firstit_old_scr;
+        // If the flow is in the top-k, record the lightest top-k node which will remain so after the flow is removed
+        NodeIndex lightest_remaining_topk = sentinel;
+        bool in_topk = nodes[node].in_topk;
+        if(in_topk)
+            lightest_remaining_topk = (topk_boundary == node) ? Next(node) : topk_boundary;
 
-        bool old_scr_is_first_valid;  // Use this flag to record whether the old SCR was the first valid one or not
-        if(firstit_old_scr == countlist.begin())
-            old_scr_is_first_valid = true;  // It was the first, we don't need to record anything
-        else{
-            old_scr_is_first_valid = false;  // It was not
-            previous_of_firstit_old_scr = GetPrevListIt(firstit_old_scr);  // We need to record the node which precedes the fist node in the old SCR
-        }
+        RemoveFromRange(node);  // Remove the flow from the same count range it currently is in
 
-        RemoveFromRange(old_listit);  // Remove the flow from the same count range it currently is in
+        Unlink(node);  // Take the node out of the list
+        uint count = --nodes[node].count;  // Decrement count
 
-        countlist.erase(old_listit);  // Remove the count node from the list
-        fc.count--;  // Decrement count
-
-        if(fc.count>=1){  // If after the removal of this packet there will still be packets belonging to this flow in the queue
-            FlowCountListIt new_insert_pos_it;  // Create an iterator which will store the position in the queue to where the new list node will be inserted at
-            if(old_scr_is_first_valid){  // If there is no previous valid SCR (i.e., the SCR of old_listit was the first valid one)
-                new_insert_pos_it = countlist.begin();  // Then we insert the new list node at the beginning of the list
+        if(count>=1){  // If after the removal of this packet there will still be packets belonging to this flow in the queue
+            NodeIndex new_insert_pos;  // The node before which the flow's node will be inserted
+            if(previous_of_first_old_scr == sentinel){  // If there is no previous valid SCR (i.e., the SCR of the node was the first valid one)
+                new_insert_pos = Begin();  // Then we insert the node at the beginning of the list
             }else{  // Then there is a previous valid SCR, but we don't know whether it is of the new count or smaller.
-                if(previous_of_firstit_old_scr->count == fc.count){  // Is the previous SCR of the same count?
-                    new_insert_pos_it = rangevector[previous_of_firstit_old_scr->count].First();  // Yes, add to beginning of this SCR
+                if(nodes[previous_of_first_old_scr].count == count){  // Is the previous SCR of the same count?
+                    new_insert_pos = Range(count).First();  // Yes, add to beginning of this SCR
                 }else{  // No,
-                    new_insert_pos_it = GetNextListIt(previous_of_firstit_old_scr);  // Insert (a new single SCR) after the previous SCR.
+                    new_insert_pos = Next(previous_of_first_old_scr);  // Insert (a new single SCR) after the previous SCR.
                 }
             }
-            FlowCountListIt new_listit = countlist.insert(new_insert_pos_it, fc);  // Create/move the flow count into a count list node
-            AddToRange(new_listit);  // Update the related SCR element
+            LinkBefore(node, new_insert_pos);  // Move the node to its new position in the count list
+            AddToRange(node);  // Update the related SCR element
 
-            flowmap[flowp] = new_listit;  // Set the flow map to point at the new list node
+            if(in_topk)
+                TopKAfterExpire(node, new_insert_pos, lightest_remaining_topk);
         }else{  // If count==0, we discard the flow
+            ReleaseNode(node);
             flowmap.erase(flowp);  // Delete the map entry
+            if(in_topk)
+                TopKAfterRemoval(flowp, lightest_remaining_topk);
         }
+
+        if(events != NULL && threshold > 0 && count+1 == threshold)
+            Emit(HittersEvent::BELOW_THRESHOLD, flowp, count);
+
+        if(checking)
+            CheckUpdate(flowp, count + 1, count);
     }
 
 protected:
-    // Add a list iterator to its corresponding SameCountRange element in the vector
-    void AddToRange(FlowCountListIt listit)
+    // The top-k is the last k nodes of the list. Append moves a node right to just after the last node of its old SCR,
+    // Expire moves it left, so membership changes only at the boundary node and is updated in O(1).
+
+    // Called in Append before the node is moved, last is the last node of its SCR. Returns true if the node will enter the top-k.
+    // Sets is_boundary if the node will still be the boundary node once reinserted.
+    bool TopKBeforeAppend(NodeIndex node, NodeIndex last, bool & is_boundary){
+        if(nodes[node].in_topk){  // It stays in, but if it was the boundary and moves its right neighbour becomes the boundary
+            if(topk_boundary == node){
+                is_boundary = (last == node);
+                if(!is_boundary)
+                    topk_boundary = Next(node);
+            }
+            return false;
+        }
+        return nodes[last].in_topk;  // It enters if it moves past a top-k node
+    }
+
+    // Called in Append after the node is inserted at its new position
+    void TopKAfterAppend(NodeIndex node, bool enters_topk, bool is_boundary){
+        if(is_boundary)  // The node was reinserted at the same position
+            topk_boundary = node;
+        if(enters_topk){
+            nodes[node].in_topk = true;
+            Emit(HittersEvent::ENTER_TOPK, node_flows[node], nodes[node].count);
+            if(list_size <= topk_k){  // A new flow while there are at most k flows, it is the lightest
+                topk_boundary = Begin();
+            }else{  // It displaces the boundary node
+                NodeIndex leaving = topk_boundary;
+                nodes[leaving].in_topk = false;
+                Emit(HittersEvent::LEAVE_TOPK, node_flows[leaving], nodes[leaving].count);
+                topk_boundary = Next(leaving);
+            }
+        }
+        if(threshold > 0 && nodes[node].count == threshold)
+            Emit(HittersEvent::ABOVE_THRESHOLD, node_flows[node], nodes[node].count);
+    }
+
+    // Called in Expire after a top-k node is inserted before insert_pos, lightest_remaining is the lightest other top-k node
+    void TopKAfterExpire(NodeIndex node, NodeIndex insert_pos, NodeIndex lightest_remaining){
+        if(insert_pos == sentinel || nodes[insert_pos].in_topk){  // It stays in
+            if(insert_pos == lightest_remaining)
+                topk_boundary = node;
+            return;
+        }
+        nodes[node].in_topk = false;  // It falls below the other top-k nodes and leaves, the node under them enters
+        Emit(HittersEvent::LEAVE_TOPK, node_flows[node], nodes[node].count);
+        topk_boundary = Prev(lightest_remaining);
+        nodes[topk_boundary].in_topk = true;
+        Emit(HittersEvent::ENTER_TOPK, node_flows[topk_boundary], nodes[topk_boundary].count);
+    }
+
+    // Called in Expire after a top-k node of flowp is discarded, lightest_remaining is the lightest other top-k node
+    void TopKAfterRemoval(FlowP flowp, NodeIndex lightest_remaining){
+        Emit(HittersEvent::LEAVE_TOPK, flowp, 0);
+        if(list_size >= topk_k){  // The node under the other top-k nodes enters
+            topk_boundary = Prev(lightest_remaining);
+            nodes[topk_boundary].in_topk = true;
+            Emit(HittersEvent::ENTER_TOPK, node_flows[topk_boundary], nodes[topk_boundary].count);
+        }else  // There are fewer than k flows, all are in the top-k
+            topk_boundary = Begin();
+    }
+
+    // Checks the invariants touched by an update of flowp from old_count to new_count: the flow map entry points at a node
+    // of the flow with the new count, the list is sorted around that node, the SCRs of both counts start and end at nodes
+    // of their count and are delimited by other counts, and the list, the map and the counts are empty together. O(1).
+    void CheckUpdate(FlowP flowp, uint old_count, uint new_count){
+        NodeIndex node = FindFlow(flowp);
+        if(new_count == 0)
+            Check(node == sentinel, "an expired flow is not in the flow map", flowp);
+        else{
+            Check(node != sentinel, "an updated flow is in the flow map", flowp);
+            Check(node_flows[node] == flowp, "the flow map points at the flow's node", flowp);
+            Check(nodes[node].count == new_count, "the flow's node has its count", flowp);
+            Check(nodes[Next(node)].prev == node && nodes[Prev(node)].next == node, "the node is linked to its neighbours", flowp);
+            Check(Prev(node) == sentinel || nodes[Prev(node)].count <= new_count, "the list is sorted before the node", flowp);
+            Check(Next(node) == sentinel || nodes[Next(node)].count >= new_count, "the list is sorted after the node", flowp);
+            Check(!LiveRange(new_count).Empty(), "the SCR of the new count is not empty", flowp);
+        }
+        CheckRange(old_count, flowp);
+        CheckRange(new_count, flowp);
+
+        bool empty = (Begin() == sentinel);
+        Check((list_size == 0) == empty && (total_count == 0) == empty && (distinct_counts == 0) == empty,
+              "the list, the flow map and the counts are empty together", flowp);
+        Check(list_size == LiveFlows(), "the list and the flow map have the same flows", flowp);
+        Check(total_count <= max_queue_size, "the total count is at most the queue size", flowp);
+        if(events != NULL && topk_k > 0 && !empty){
+            Check(nodes[topk_boundary].in_topk, "the top-k boundary node is in the top-k", flowp);
+            Check(topk_boundary == Begin() || !nodes[Prev(topk_boundary)].in_topk,
+                  "the node before the top-k boundary is not in the top-k", flowp);
+        }
+    }
+
+    // Checks the SCR of a count: empty, or its first and last nodes are of its count with other counts
+    // (or the ends of the list) around them, and a single node SCR has a size of 1
+    void CheckRange(uint count, FlowP flowp){
+        if(count == 0)
+            return;
+        SameCountRange & scr = LiveRange(count);
+        if(scr.Empty())
+            return;
+        uint size = nodes[scr.First()].range_size;
+        Check(scr.Last() != sentinel, "an SCR has both its bounds", flowp);
+        Check(nodes[scr.First()].count == count && nodes[scr.Last()].count == count, "an SCR's bounds are of its count", flowp);
+        Check(Prev(scr.First()) == sentinel || nodes[Prev(scr.First())].count < count, "an SCR starts at its first node", flowp);
+        Check(Next(scr.Last()) == sentinel || nodes[Next(scr.Last())].count > count, "an SCR ends at its last node", flowp);
+        Check(size >= 1 && (size == 1) == scr.One(), "an SCR's size agrees with its bounds", flowp);
+    }
+
+    // Reports a violated invariant and exits
+    void Check(bool holds, const char * invariant, FlowP flowp){
+        if(holds)
+            return;
+        std::cout << "Error: HL-Hitters invariant violated after operation " << memory.operations << " on flow " << *flowp
+                  << ": " << invariant << std::endl;
+        ::exit(-1);
+    }
+
+    // Pushes an event to the subscriber, counting it as dropped if the queue is full
+    void Emit(HittersEvent::Type type, FlowP flowp, uint count){
+        if(!events->push(HittersEvent(type, flowp, count)))
+            dropped_events++;
+    }
+
+    // Add a list node to its corresponding SameCountRange element in the vector
+    void AddToRange(NodeIndex node)
     {
-        uint new_count = listit->count;
+        uint new_count = nodes[node].count;
 
-        SameCountRange & new_scr = rangevector[new_count];
+        SameCountRange & new_scr = LiveRange(new_count, node);
         if(new_scr.Empty()){
             // This was empty. create with one entry
-            new_scr.SetFirstLast(listit, listit);
+            new_scr.SetFirstLast(node, node);
+            nodes[node].range_size = 1;
+            distinct_counts++;
         }else{
-            // Replace the beginning of the range with this one
-            new_scr.SetFirst(listit);
+            // Replace the beginning of the range with this one, which takes over its size
+            nodes[node].range_size = nodes[new_scr.First()].range_size + 1;
+            new_scr.SetFirst(node);
         }
     }
 
-    // Remove a list iterator from its corresponding SameCountRange element in the vector
-    void RemoveFromRange(FlowCountListIt listit)
+    // Remove a list node from its corresponding SameCountRange element in the vector
+    void RemoveFromRange(NodeIndex node)
     {
-        uint old_count = listit->count;
-        SameCountRange & old_scr = rangevector[old_count];
+        uint old_count = nodes[node].count;
+        SameCountRange & old_scr = Range(old_count);
         if(old_scr.One()){
             // This was the last flow with this count -><- (delete)
             old_scr.Clear();
-        }else if(listit == old_scr.First()){
+            distinct_counts--;
+        }else if(node == old_scr.First()){
             // This was the first in the range ->
-            old_scr.SetFirst( GetNextListIt(old_scr.First()) );  // Make the range start at the next list node
-        }else if(listit == old_scr.Last()){
-            // This was the last in the range ->
-            old_scr.SetLast ( GetPrevListIt(old_scr.Last()) );  // Make the range start at the previous list node
+            old_scr.SetFirst( Next(old_scr.First()) );  // Make the range start at the next list node
+            nodes[old_scr.First()].range_size = nodes[node].range_size - 1;  // which takes over the size
+        }else{
+            nodes[old_scr.First()].range_size--;
+            if(node == old_scr.Last()){
+                // This was the last in the range ->
+                old_scr.SetLast ( Prev(old_scr.Last()) );  // Make the range start at the previous list node
+            }
         }
     }
 
-    // Get a new iterator pointing to the next item in the list (Helper)
-    FlowCountListIt GetNextListIt(FlowCountListIt it) const {
-        FlowCountListIt next = it;
-        ++next;
-        return next;
+    // Returns the SCR of a count which has nodes in the list
+    SameCountRange & Range(uint count){
+        return rangevector[count];
     }
 
-    // Get a new iterator pointing to the previous item in the list (Helper)
-    FlowCountListIt GetPrevListIt(FlowCountListIt it) const {
-        FlowCountListIt prev = it;
-        --prev;
-        return prev;
+    // Returns the SCR of any count, clearing it first if it is stale. An SCR whose count has no nodes is not updated,
+    // so after a Reset() or once emptied it may refer to nodes since reused. It is stale unless its first node is in use,
+    // with its count, and is not the node being added (except), which is not in the SCR yet. The released and the unused
+    // nodes have a count of 0 or are past used_nodes.
+    SameCountRange & LiveRange(uint count, NodeIndex except = sentinel){
+        SameCountRange & scr = rangevector[count];
+        NodeIndex first = scr.First();
+        if(first != sentinel && (first == except || first >= used_nodes || nodes[first].count != count))
+            scr.Clear();
+        return scr;
     }
-public:
-    friend std::ostream& operator<< (std::ostream &, FlowCount &);
-    friend std::ostream& operator<< (std::ostream &, HLHittersAlgorithm &);
-    friend std::ostream& operator<< (std::ostream &, SameCountRange &);
 
-};
+    // Returns the number of nodes with a count which has nodes in the list
+    uint RangeSize(uint count) const {
+        return nodes[rangevector[count].First()].range_size;
+    }
 
+    // Returns the count list node of a flow, the sentinel if it is not counted
+    NodeIndex FindFlow(FlowP flowp){
+        FlowMapIt flowit = flowmap.find(flowp);
+        if(flowit == flowmap.end() || flowit->second.generation != generation)
+            return sentinel;
+        return flowit->second.node;
+    }
 
-// Helper function for printing
-std::ostream& operator<< (std::ostream &out, HLHittersAlgorithm::FlowCount & fc){
-    out << "FC[" << fc.count << ", " << *(fc.flowp) << "]";
-    return out;
-}
+    // Sets the count list node of a flow in the flow map, reviving a stale entry
+    void SetFlow(FlowP flowp, NodeIndex node){
+        std::pair<FlowMapIt, bool> inserted = flowmap.insert(FlowMapPair(flowp, FlowEntry()));
+        FlowEntry & entry = inserted.first->second;
+        if(!inserted.second && entry.generation != generation)
+            stale_flows--;
+        entry.node = node;
+        entry.generation = generation;
+    }
 
-// Helper function for printing
-std::ostream& operator<< (std::ostream &out, HLHittersAlgorithm::SameCountRange & scr){
-    if(scr.Empty()){
-        out << "S[/]";
-    }else if(scr.One()){
-        out << "S["<< *(scr.First()) << "]";
-    }else{
-        out << "S[";
-        HLHittersAlgorithm::FlowCountListIt cur=scr.First();
-        for(; cur!=scr.Last() ;++cur)
-            out << *cur << ",";
-        out << *cur << "]";
+    // Returns the number of flows counted, the flow map entries which are not stale. O(1).
+    uint LiveFlows() const {
+        return flowmap.size() - stale_flows;
+    }
+
+    // Creates an unlinked node of flowp with count. The released nodes are reused first,
+    // then the unused ones of the pool, and the pool only grows when all its nodes are in the list.
+    NodeIndex NewNode(FlowP flowp, uint count){
+        NodeIndex node;
+        if(free_nodes != sentinel){
+            node = free_nodes;
+            free_nodes = nodes[node].next;
+        }else{
+            node = used_nodes++;
+            if(node == nodes.size()){
+                nodes.push_back(Node());
+                node_flows.push_back(NULL);
+            }
+        }
+        nodes[node].count = count;
+        nodes[node].in_topk = false;
+        node_flows[node] = flowp;
+        return node;
+    }
+
+    // Releases an unlinked node for reuse
+    void ReleaseNode(NodeIndex node){
+        nodes[node].next = free_nodes;
+        free_nodes = node;
+    }
+
+    // Links an unlinked node into the list before pos, the sentinel to link it last
+    void LinkBefore(NodeIndex node, NodeIndex pos){
+        NodeIndex prev = nodes[pos].prev;
+        nodes[node].prev = prev;
+        nodes[node].next = pos;
+        nodes[prev].next = node;
+        nodes[pos].prev = node;
+        list_size++;
+    }
+
+    // Unlinks a node from the list, its neighbours are linked to each other
+    void Unlink(NodeIndex node){
+        NodeIndex prev = nodes[node].prev, next = nodes[node].next;
+        nodes[prev].next = next;
+        nodes[next].prev = prev;
+        list_size--;
     }
-    return out;
-}
+
+    // Returns the first (lightest) node of the list, the sentinel if it is empty
+    NodeIndex Begin() const {
+        return nodes[sentinel].next;
+    }
+
+    // Returns the last (heaviest) node of the list, the sentinel if it is empty
+    NodeIndex Heaviest() const {
+        return nodes[sentinel].prev;
+    }
+
+    // Get the next node in the list (Helper)
+    NodeIndex Next(NodeIndex node) const {
+        return nodes[node].next;
+    }
+
+    // Get the previous node in the list (Helper)
+    NodeIndex Prev(NodeIndex node) const {
+        return nodes[node].prev;
+    }
+public:
+    friend std::ostream& operator<< (std::ostream &, HLHittersAlgorithm &);
+
+};
+
 
 // Helper function for printing
 std::ostream& operator<< (std::ostream &out, HLHittersAlgorithm & hl){
     out << "   Flow Count List:" << std::endl;
-    out << "     " << hl.countlist << std::endl;
+    out << "     L(" << hl.list_size << "): ";
+    for(HLHittersAlgorithm::NodeIndex cur = hl.Begin(); cur != HLHittersAlgorithm::sentinel; cur = hl.Next(cur))
+        out << "FC[" << hl.nodes[cur].count << ", " << *hl.node_flows[cur] << "] <-> ";
+    out << "End" << std::endl;
     out << "   Same Count Range Vector:" << std::endl;
-    out << "     " << hl.rangevector << std::endl;
+    out << "     V(" << hl.rangevector.size() << "): ";
+    for(uint i=0; i<hl.rangevector.size(); ++i){  // Through LiveRange(), the stale SCRs refer to reused nodes
+        HLHittersAlgorithm::SameCountRange & scr = hl.LiveRange(i);
+        out << i << ":S[";
+        if(!scr.Empty())
+            for(HLHittersAlgorithm::NodeIndex cur = scr.First(); ; cur = hl.Next(cur)){
+                out << "FC[" << hl.nodes[cur].count << ", " << *hl.node_flows[cur] << "]";
+                if(cur == scr.Last())
+                    break;
+                out << ",";
+            }
+        else
+            out << "/";
+        out << "], ";
+    }
+    out << "End" << std::endl;
     return out;
 }
 
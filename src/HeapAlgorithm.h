@@ -0,0 +1,290 @@
+/*
+HeapAlgorithm.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEAPALGORITHM_H_
+#define HEAPALGORITHM_H_
+
+#include "Common.h"
+#include "Algorithm.h"
+
+// Heaviest Hitters algorithm keeping the flows in an indexed binary max-heap on their counts.
+// Append and Expire move a flow up or down the heap in O(log F) and QueryHeaviest explores only the k heaviest nodes in O(k log k).
+class HeapAlgorithm : public Algorithm {
+protected:
+    typedef std::vector<FlowCountPair, TrackingAllocator<FlowCountPair> > HeapVector;  // The heap, heaviest at index 0
+    typedef std::vector<uint, TrackingAllocator<uint> > PositionVector;  // The heap index + 1 of each flow id, 0 if not counted
+
+    // Orders heap indices by the counts at them, used for the frontier of QueryHeaviest
+    struct IsLighterAt{
+        const HeapVector * heap;
+        IsLighterAt(const HeapVector * heap):heap(heap){}
+        bool operator()(uint i, uint j) const { return (*heap)[i].second < (*heap)[j].second; }
+    };
+
+    AllocationStats memory;  // The memory usage of the heap and the positions, recorded when tracking is enabled
+    bool track_memory;  // Whether the memory usage and the operations are recorded
+    HeapVector heap;  // The heap of flows and their counts
+    PositionVector positions;  // Indexed by the flow ids, which are dense, so no hash table is needed
+    uint total_count;  // The sum of the counts in the heap
+
+    // Heap indices used in the queries as a intermediate container.
+    // Kept at class level to amortize initialization/allocation costs
+    std::vector<uint> frontier;
+
+    // A vector of counts used in QueryHistogram as a intermediate sorting container.
+    // Kept at class level to amortize initialization/allocation costs
+    std::vector<uint> counts;
+
+public:
+    // Constructor, track_memory enables recording the memory usage of the heap
+    HeapAlgorithm(bool track_memory = false)
+    :track_memory(track_memory), heap(HeapVector::allocator_type(track_memory ? &memory : NULL)),
+     positions(PositionVector::allocator_type(track_memory ? &memory : NULL)),
+     total_count(0)
+    {
+        memory.EndSetup();
+    }
+
+    // Executed when a new item is received
+    virtual void Append(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count++;
+        uint pos = Position(packet.flowp);
+        if(pos == 0){  // A new flow, add it as a leaf
+            heap.push_back(FlowCountPair(packet.flowp, 0));
+            pos = heap.size();
+            positions[packet.flowp->id] = pos;
+        }
+        heap[pos-1].second++;
+        SiftUp(pos-1);
+    }
+
+    // Executed when an item is served
+    virtual void Expire(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count--;
+        uint i = Position(packet.flowp) - 1;
+        if(--heap[i].second > 0){
+            SiftDown(i);
+            return;
+        }
+        // The flow's last packet, replace it with the last leaf and restore the heap around it
+        positions[packet.flowp->id] = 0;
+        heap[i] = heap.back();
+        heap.pop_back();
+        if(i < heap.size()){
+            positions[heap[i].first->id] = i+1;
+            SiftDown(SiftUp(i));
+        }
+    }
+
+    // Returns the memory usage of the heap and the positions
+    virtual AllocationStats MemoryStats(){
+        return memory;
+    }
+
+    // Calculates and returns the k Heaviest Hitters in the provided result container.
+    // The heaviest remaining node is always a child of a returned node, so a frontier heap of them is enough.
+    virtual void QueryHeaviest(uint k, HittersQueryResult & result){
+        StartFrontier();
+        IsLighterAt cmp(&heap);
+        for(uint n=0; n<k && !frontier.empty(); ++n)
+            result.push_back(heap[PopFrontier(cmp)]);
+    }
+
+    // Writes the flows with a count of at least c, heaviest first, into result (at most max_results) and returns their number
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results){
+        StartFrontier();
+        IsLighterAt cmp(&heap);
+        uint n = 0;
+        for(; n<max_results && !frontier.empty() && heap[frontier.front()].second>=c; ++n)
+            result[n] = heap[PopFrontier(cmp)];
+        return n;
+    }
+
+    // Returns the number of packets currently counted
+    virtual uint TotalCount(){
+        return total_count;
+    }
+
+    // Returns the count of a flow, 0 if it is not counted
+    virtual uint GetCount(FlowP flowp){
+        uint pos = Position(flowp);
+        return (pos != 0) ? heap[pos-1].second : 0;
+    }
+
+    // Returns 1 + the number of flows with a greater count than flowp, 0 if it is not counted.
+    // The heavier flows form a subtree at the root, so this is O(rank).
+    virtual uint Rank(FlowP flowp){
+        uint count = GetCount(flowp);
+        return (count != 0) ? 1 + CountHeavier(count, heap.size()) : 0;
+    }
+
+    // Returns true if fewer than k flows have a greater count than flowp, stopping once k heavier flows are found: O(k)
+    virtual bool IsInTopK(FlowP flowp, uint k){
+        uint count = GetCount(flowp);
+        return count != 0 && k != 0 && CountHeavier(count, k) < k;
+    }
+
+    // The flow size distribution queries are not helped by the heap order, they sort or scan every count as BruteForce does
+
+    // Returns the number of flows at each count in the provided result container
+    virtual void QueryHistogram(FlowSizeHistogram & result){
+        counts.clear();
+        foreach(FlowCountPair & fc, heap)
+            counts.push_back(fc.second);
+        std::sort(counts.begin(), counts.end());
+        foreach(uint c, counts){
+            if(!result.empty() && result.back().first == c)
+                result.back().second++;
+            else
+                result.push_back(CountFlowsPair(c, 1));
+        }
+    }
+
+    // Returns the number of distinct counts among the flows
+    virtual uint DistinctCounts(){
+        FlowSizeHistogram histogram;
+        QueryHistogram(histogram);
+        return histogram.size();
+    }
+
+    // Returns the count of the flow at position ceil(q*flows) in increasing count order, 0 if no flows are counted
+    virtual uint FlowSizeQuantile(double q){
+        if(heap.empty())
+            return 0;
+        counts.clear();
+        foreach(FlowCountPair & fc, heap)
+            counts.push_back(fc.second);
+        uint pos = QuantilePosition(q, counts.size());
+        std::nth_element(counts.begin(), counts.begin() + pos - 1, counts.end());
+        return counts[pos - 1];
+    }
+
+    // Returns the Shannon entropy in bits of the distribution of the counted packets over the flows
+    virtual double FlowSizeEntropy(){
+        double entropy = 0.0;
+        foreach(FlowCountPair & fc, heap)
+            entropy += EntropyTerm(fc.second, 1, total_count);
+        return entropy;
+    }
+
+    // Empties the heap, keeping its capacity and the positions, whose entries of the counted flows are cleared: O(flows)
+    virtual bool Reset(){
+        foreach(FlowCountPair & fc, heap)
+            positions[fc.first->id] = 0;
+        heap.clear();
+        total_count = 0;
+        memory.Restart();
+        return true;
+    }
+
+    // Rebuilds the heap from n flows, heaviest first, on an empty algorithm.
+    // In that order every parent precedes its children, so the flows already form a heap: O(n).
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        if(!heap.empty())
+            return false;
+        for(uint i=0; i<n; ++i){
+            if(flows[i].second == 0 || (i > 0 && flows[i].second > flows[i-1].second) || Position(flows[i].first) != 0)
+                return false;
+            heap.push_back(flows[i]);
+            positions[flows[i].first->id] = heap.size();
+            total_count += flows[i].second;
+        }
+        return true;
+    }
+
+protected:
+    // Returns the heap index + 1 of a flow, 0 if it is not counted. Grows the positions to cover its id.
+    uint Position(FlowP flowp){
+        if(flowp->id >= positions.size())
+            positions.resize(std::max<std::size_t>(flowp->id + 1, 2 * positions.size()), 0);
+        return positions[flowp->id];
+    }
+
+    // Swaps two heap nodes, keeping the positions up to date
+    void Swap(uint i, uint j){
+        std::swap(heap[i], heap[j]);
+        positions[heap[i].first->id] = i+1;
+        positions[heap[j].first->id] = j+1;
+    }
+
+    // Moves node i towards the root while it is heavier than its parent, returns its new index
+    uint SiftUp(uint i){
+        while(i > 0 && heap[(i-1)/2].second < heap[i].second){
+            Swap(i, (i-1)/2);
+            i = (i-1)/2;
+        }
+        return i;
+    }
+
+    // Moves node i towards the leaves while a child is heavier than it
+    void SiftDown(uint i){
+        while(true){
+            uint heaviest = i, l = 2*i+1, r = 2*i+2;
+            if(l < heap.size() && heap[l].second > heap[heaviest].second) heaviest = l;
+            if(r < heap.size() && heap[r].second > heap[heaviest].second) heaviest = r;
+            if(heaviest == i)
+                return;
+            Swap(i, heaviest);
+            i = heaviest;
+        }
+    }
+
+    // Resets the frontier to the root
+    void StartFrontier(){
+        frontier.clear();
+        if(!heap.empty())
+            frontier.push_back(0);
+    }
+
+    // Removes the heaviest node of the frontier, adds its children and returns it
+    uint PopFrontier(IsLighterAt & cmp){
+        std::pop_heap(frontier.begin(), frontier.end(), cmp);
+        uint i = frontier.back();
+        frontier.pop_back();
+        for(uint c=2*i+1; c<=2*i+2 && c<heap.size(); ++c){
+            frontier.push_back(c);
+            std::push_heap(frontier.begin(), frontier.end(), cmp);
+        }
+        return i;
+    }
+
+    // Returns the number of flows with a greater count than count, stopping at limit
+    uint CountHeavier(uint count, uint limit){
+        uint heavier = 0;
+        StartFrontier();
+        while(!frontier.empty() && heavier < limit){
+            uint i = frontier.back();
+            frontier.pop_back();
+            if(heap[i].second <= count)  // Its whole subtree is no heavier
+                continue;
+            heavier++;
+            for(uint c=2*i+1; c<=2*i+2 && c<heap.size(); ++c)
+                frontier.push_back(c);
+        }
+        return heavier;
+    }
+};
+
+#endif /* HEAPALGORITHM_H_ */
@@ -0,0 +1,231 @@
+/*
+HierarchicalAlgorithm.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HIERARCHICALALGORITHM_H_
+#define HIERARCHICALALGORITHM_H_
+
+#include "Common.h"
+#include "Algorithm.h"
+#include "HLHittersAlgorithm.h"
+#include "StreamSummaryAlgorithm.h"
+
+// Hierarchical Heaviest Hitters over the source address prefixes of the flows.
+// Besides the HL-Hitters structure of the flows, every prefix level (e.g. /16, /24, /32) has its own HL-Hitters structure
+// of the prefixes, all counting the same window. Each prefix also counts the prefixes of the next level within it,
+// so the heaviest /24s and then the heaviest hosts within one of them are found in O(k) per level.
+// An update walks the levels once with the flow's address: O(levels).
+class HierarchicalAlgorithm : public Algorithm {
+protected:
+    // A prefix of one level, counted as a flow of its level
+    struct Prefix{
+        Flow flow;  // The prefix as a flow, its id and address are the prefix address
+        StreamSummaryAlgorithm * within;  // The prefixes of the next level within this one, NULL at the last level
+
+        Prefix(uint32_t addr, StreamSummaryAlgorithm * within)
+        :flow(addr, addr), within(within) {}
+    };
+    typedef boost::unordered_map<uint32_t, Prefix*> PrefixTable;  // Maps prefix addresses to prefixes
+
+    // One level of the hierarchy
+    struct Level{
+        uint length;  // The prefix length in bits
+        uint32_t mask;  // The prefix mask
+        HLHittersAlgorithm * hitters;  // The heaviest prefixes of the level
+        PrefixTable table;  // The prefixes seen so far, kept once seen like the flows themselves
+        std::deque<Prefix> prefixes;  // A deque so that the pointers in the table stay valid as it grows
+    };
+
+    bool track_memory;  // Whether the memory usage of the structures is recorded
+    HLHittersAlgorithm flows;  // The heaviest flows, which answer the Algorithm interface
+    std::vector<Level> levels;  // The prefix levels, from the shortest prefix
+
+public:
+    // Constructor, prefix_lengths are the levels in increasing order, each in [1,32].
+    // With an arena the HL-Hitters structures take their memory from its huge pages.
+    HierarchicalAlgorithm(uint max_queue_size, const std::vector<uint> & prefix_lengths, bool track_memory = false, HugePageArena * arena = NULL)
+    :track_memory(track_memory), flows(max_queue_size, track_memory, arena), levels(prefix_lengths.size())
+    {
+        for(uint i=0; i<levels.size(); ++i){
+            levels[i].length = prefix_lengths[i];
+            levels[i].mask = (prefix_lengths[i] >= 32) ? 0xFFFFFFFFu : ~(0xFFFFFFFFu >> prefix_lengths[i]);
+            levels[i].hitters = new HLHittersAlgorithm(max_queue_size, track_memory, arena);
+        }
+    }
+
+    ~HierarchicalAlgorithm(){
+        foreach(Level & level, levels){
+            foreach(Prefix & prefix, level.prefixes)
+                delete prefix.within;
+            delete level.hitters;
+        }
+    }
+
+    // Executed when a new item is received
+    virtual void Append(Packet & packet){
+        flows.Append(packet);
+        Prefix * parent = NULL;
+        for(uint i=0; i<levels.size(); ++i){
+            Prefix * prefix = GetPrefix(i, packet.flowp->addr & levels[i].mask);
+            Packet p(&prefix->flow, packet.seq_num, packet.length);
+            levels[i].hitters->Append(p);
+            if(parent != NULL)
+                parent->within->Append(p);
+            parent = prefix;
+        }
+    }
+
+    // Executed when an item is served
+    virtual void Expire(Packet & packet){
+        flows.Expire(packet);
+        Prefix * parent = NULL;
+        for(uint i=0; i<levels.size(); ++i){
+            Prefix * prefix = levels[i].table[packet.flowp->addr & levels[i].mask];
+            Packet p(&prefix->flow, packet.seq_num, packet.length);
+            levels[i].hitters->Expire(p);
+            if(parent != NULL)
+                parent->within->Expire(p);
+            parent = prefix;
+        }
+    }
+
+    // The flow queries are answered by the HL-Hitters structure of the flows
+    virtual void QueryHeaviest(uint k, HittersQueryResult & result) { flows.QueryHeaviest(k, result); }
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results) { return flows.QueryAboveCount(c, result, max_results); }
+    virtual uint TotalCount() { return flows.TotalCount(); }
+    virtual uint GetCount(FlowP flowp) { return flows.GetCount(flowp); }
+    virtual uint Rank(FlowP flowp) { return flows.Rank(flowp); }
+    virtual bool IsInTopK(FlowP flowp, uint k) { return flows.IsInTopK(flowp, k); }
+    virtual void QueryHistogram(FlowSizeHistogram & result) { flows.QueryHistogram(result); }
+    virtual uint DistinctCounts() { return flows.DistinctCounts(); }
+    virtual uint FlowSizeQuantile(double q) { return flows.FlowSizeQuantile(q); }
+    virtual double FlowSizeEntropy() { return flows.FlowSizeEntropy(); }
+
+    // Returns the memory usage of all the structures, the flows', the levels' and the prefixes'
+    virtual AllocationStats MemoryStats(){
+        AllocationStats total = flows.MemoryStats();
+        foreach(Level & level, levels){
+            Add(total, level.hitters->MemoryStats());
+            foreach(Prefix & prefix, level.prefixes)
+                if(prefix.within != NULL)
+                    Add(total, prefix.within->MemoryStats());
+        }
+        total.operations = flows.MemoryStats().operations;  // An operation updates every structure once
+        return total;
+    }
+
+    // Resizes every HL-Hitters structure, they all count the same window
+    virtual bool Resize(uint max_queue_size){
+        if(!flows.Resize(max_queue_size))
+            return false;
+        foreach(Level & level, levels)
+            level.hitters->Resize(max_queue_size);
+        return true;
+    }
+
+    // Empties every structure, keeping the prefixes seen so far like the flows themselves.
+    // The HL-Hitters structures are reset in O(1), the counts of the prefixes within each prefix in O(prefixes).
+    virtual bool Reset(){
+        flows.Reset();
+        foreach(Level & level, levels){
+            level.hitters->Reset();
+            foreach(Prefix & prefix, level.prefixes)
+                if(prefix.within != NULL)
+                    prefix.within->Reset();
+        }
+        return true;
+    }
+
+    // Enables checking the invariants of every HL-Hitters structure after each update, see HLHittersAlgorithm::SetChecking()
+    void SetChecking(bool enable){
+        flows.SetChecking(enable);
+        foreach(Level & level, levels)
+            level.hitters->SetChecking(enable);
+    }
+
+    // Returns the number of prefix levels
+    uint Levels() const {
+        return levels.size();
+    }
+
+    // Returns the prefix length of a level
+    uint PrefixLength(uint level) const {
+        return levels[level].length;
+    }
+
+    // Returns the prefix mask of a level
+    uint32_t PrefixMask(uint level) const {
+        return levels[level].mask;
+    }
+
+    // Returns the k heaviest prefixes of a level. Their ids are the prefix addresses. O(k).
+    void QueryPrefixes(uint level, uint k, HittersQueryResult & result){
+        levels[level].hitters->QueryHeaviest(k, result);
+    }
+
+    // Returns the count of a prefix of a level, 0 if it is not counted
+    uint PrefixCount(uint level, uint32_t prefix){
+        PrefixTable::iterator it = levels[level].table.find(prefix);
+        return (it != levels[level].table.end()) ? levels[level].hitters->GetCount(&it->second->flow) : 0;
+    }
+
+    // Returns the k heaviest prefixes of the next level within a prefix of a level (not the last). O(k).
+    void QueryWithin(uint level, uint32_t prefix, uint k, HittersQueryResult & result){
+        PrefixTable::iterator it = levels[level].table.find(prefix);
+        if(it != levels[level].table.end())
+            it->second->within->QueryHeaviest(k, result);
+    }
+
+    // Returns the k heaviest prefixes of the first level in result[0], and then at each next level
+    // the k heaviest prefixes within the heaviest one of the previous level. O(k) per level.
+    void QueryDrillDown(uint k, std::vector<HittersQueryResult> & result){
+        result.resize(levels.size());
+        for(uint i=0; i<levels.size(); ++i){
+            result[i].clear();
+            if(i == 0)
+                QueryPrefixes(0, k, result[0]);
+            else if(!result[i-1].empty())
+                QueryWithin(i-1, result[i-1][0].first->addr, k, result[i]);
+        }
+    }
+
+protected:
+    // Returns the prefix of a level with the given address, creating it on first sight
+    Prefix * GetPrefix(uint level, uint32_t addr){
+        Level & l = levels[level];
+        PrefixTable::iterator it = l.table.find(addr);
+        if(it != l.table.end())
+            return it->second;
+        bool last = (level + 1 == levels.size());
+        l.prefixes.push_back(Prefix(addr, last ? NULL : new StreamSummaryAlgorithm(track_memory)));
+        return l.table[addr] = &l.prefixes.back();
+    }
+
+    // Adds the memory usage of a structure to a total
+    static void Add(AllocationStats & total, const AllocationStats & s){
+        total.live_bytes += s.live_bytes;
+        total.peak_bytes += s.peak_bytes;  // An upper bound, the structures peak at different times
+        total.allocations += s.allocations;
+        total.deallocations += s.deallocations;
+        total.setup_allocations += s.setup_allocations;
+    }
+};
+
+#endif /* HIERARCHICALALGORITHM_H_ */
@@ -0,0 +1,35 @@
+/*
+HugePages.cpp
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Experiment.h"
+#include "CommandLine.h"
+#include "HugePages.h"
+
+// Compares the throughput and the data TLB misses of large windows on the normal pages and on huge pages. For example:
+//   HL-Hitters-HugePages -q 1000000,4000000 -f 1000000 -s 20000000 -H 2m,1g
+int main(int argc, char **argv){
+
+    HugePagesParams hp = readHugePagesParams(argc, argv);  // Get the benchmark params from the command line
+    HugePagesRunner runner(hp);
+    runner.Run();  // Run the benchmark
+
+    return 0;
+}
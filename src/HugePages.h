@@ -0,0 +1,99 @@
+/*
+HugePages.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HUGEPAGES_H_
+#define HUGEPAGES_H_
+
+#include "Common.h"
+#include "Experiment.h"
+#include "Platform.h"
+#include "Timer.h"
+
+// The parameters of a huge page benchmark
+struct HugePagesParams{
+    Experiment::Params params;  // The experiment to run, with each queue size and page size
+    std::vector<uint> queue_sizes;  // The queue sizes (windows) to benchmark
+    std::vector<std::size_t> page_sizes;  // The page sizes to benchmark, 0 for the normal pages
+    uint times;  // The number of repetitions of each configuration
+};
+
+// Benchmarks an algorithm over large windows with its queue and structures on the normal pages and on huge pages.
+// Each configuration reports the throughput and the data TLB misses per operation, and the huge page configurations
+// their speedup over the normal pages of the same window, which is run first.
+class HugePagesRunner {
+    HugePagesParams hp;  // The benchmark parameters
+
+public:
+    HugePagesRunner(const HugePagesParams & hp)
+    :hp(hp) {}
+
+    // Runs every configuration and prints a line for each
+    void Run(){
+        foreach(uint max_queue_size, hp.queue_sizes){
+            double base_seconds = 0.0;  // The mean time on the normal pages
+            std::vector<std::size_t> page_sizes = hp.page_sizes;
+            page_sizes.erase(std::remove(page_sizes.begin(), page_sizes.end(), (std::size_t)0), page_sizes.end());
+            page_sizes.insert(page_sizes.begin(), 0);  // The normal pages are the reference, run first
+            foreach(std::size_t page_size, page_sizes){
+                Experiment::Params p = hp.params;
+                p.max_queue_size = max_queue_size;
+                p.huge_pages = page_size;
+                MultiShotTimer timer;
+                uint64_t misses = 0, ops = 0;
+                bool counted = true;
+                uint64_t hugetlb = 0, thp = 0, bound = 0, mapped = 0;  // The arena statistics of the last repetition
+                for(uint i = 0; i < hp.times; i++){
+                    Experiment exp(p);
+                    PerfCounter counter;
+                    counted = counter.Available();
+                    timer.Start();
+                    counter.Start();
+                    exp.UniformExperiment();
+                    misses += counter.Stop();
+                    timer.Stop();
+                    ops += exp.GetCurrentIteration();
+                    const HugePageArena & q = exp.GetQueueArena(), & a = exp.GetAlgorithmArena();
+                    hugetlb = q.HugeTlbRegions() + a.HugeTlbRegions();
+                    thp = q.ThpRegions() + a.ThpRegions();
+                    bound = q.BoundRegions() + a.BoundRegions();
+                    mapped = q.MappedBytes() + a.MappedBytes();
+                }
+                if(page_size == 0)
+                    base_seconds = timer.Mean();
+                std::cout << "Ran as: " << p << (page_size ? "" : ", HugePages:none")
+                          << ", Execution Time Statistics: " << timer
+                          << ", OpsPerSec:" << (timer.Mean() > 0 ? ops / hp.times / timer.Mean() : 0.0)
+                          << ", DTLBMissesPerOp:";
+                if(counted)
+                    std::cout << (ops ? (double)misses / ops : 0.0);
+                else
+                    std::cout << "unavailable";
+                if(page_size != 0)
+                    std::cout << ", Speedup:" << (timer.Mean() > 0 ? base_seconds / timer.Mean() : 0.0)
+                              << ", HugeTlbRegions:" << hugetlb << ", ThpRegions:" << thp << ", BoundRegions:" << bound
+                              << ", MappedBytes:" << mapped;
+                std::cout << std::endl;
+            }
+        }
+    }
+};
+
+#endif /* HUGEPAGES_H_ */
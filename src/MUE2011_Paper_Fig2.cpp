@@ -20,6 +20,7 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "Experiment.h"
+#include "TeeExperiment.h"
 #include "CommandLine.h"
 
 
@@ -45,14 +46,13 @@ int main(int argc, char **argv){
     std::vector<Experiment::AlgorithmType> alg_types;  // The algorithms simulated
     alg_types += Experiment::NOPROCESSING, Experiment::BRUTEFORCE, Experiment::HLHITTERS;
 
-    // Run every combination of queue size and algorithm (Cartesian product)
-    foreach(Experiment::AlgorithmType alg_type, alg_types){
-        foreach(uint max_queue_size, max_queue_sizes){
-            p.alg_type = alg_type;
-            p.max_queue_size = max_queue_size;
-            p.number ++;
-            Experiment::RunExperiment(p, times);
-        }
+    // Run every combination of queue size and algorithm (Cartesian product),
+    // the algorithms of each queue size on the same generated packets
+    p.tee = alg_types;
+    foreach(uint max_queue_size, max_queue_sizes){
+        p.max_queue_size = max_queue_size;
+        p.number ++;
+        TeeExperiment::RunTee(p, times);
     }
 
     return 0;
@@ -52,7 +52,10 @@ int main(int argc, char **argv){
             p.flow_count = flow_count;
             p.max_queue_size = max_queue_size;
             p.number ++;
+            p.memory_stats = false;  // Time the runs without the memory tracking
             Experiment::RunExperiment(p, times);
+            p.memory_stats = true;  // Then print the memory usage from a separate run, which is not timed for the figure
+            Experiment::RunExperiment(p, 1);
         }
     }
 
@@ -20,13 +20,20 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "Experiment.h"
+#include "TeeExperiment.h"
+#include "PipelineExperiment.h"
 #include "CommandLine.h"
 
 
 int main(int argc, char **argv){
 
     std::pair<Experiment::Params,uint> result = readExperimentParams(argc, argv);  // Get the experiment params from the command line
-    Experiment::RunExperiment(result.first, result.second);  // Run the experiment
+    if(!result.first.tee.empty())
+        TeeExperiment::RunTee(result.first, result.second);  // Run the algorithms on the same packets
+    else if(result.first.pipeline)
+        PipelineExperiment::RunPipeline(result.first, result.second);  // Run the stages on separate threads
+    else
+        Experiment::RunExperiment(result.first, result.second);  // Run the experiment
 
     return 0;
 }
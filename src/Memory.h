@@ -0,0 +1,288 @@
+/*
+Memory.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include "Common.h"
+
+#include <memory>
+#include <limits>
+#include <stdint.h>
+#include <sys/mman.h>  // For mmap() and madvise()
+#include <sys/syscall.h>  // For the mbind and getcpu system calls
+#include <unistd.h>
+#include <linux/mempolicy.h>  // For MPOL_BIND
+
+// Memory usage statistics of the containers of an algorithm
+struct AllocationStats{
+    uint64_t live_bytes;  // The bytes currently allocated
+    uint64_t peak_bytes;  // The maximum of live_bytes
+    uint64_t allocations;  // The number of allocations
+    uint64_t deallocations;  // The number of deallocations
+    uint64_t setup_allocations;  // The number of allocations made during construction, before any operation
+    uint64_t operations;  // The number of Append and Expire operations
+
+    AllocationStats()
+    :live_bytes(0), peak_bytes(0), allocations(0), deallocations(0), setup_allocations(0), operations(0) {}
+
+    // Starts a new measurement with the memory currently allocated, as if it had been allocated during construction
+    void Restart(){
+        peak_bytes = live_bytes;
+        allocations = deallocations = setup_allocations = operations = 0;
+    }
+
+    // Returns the mean number of allocations made by an Append or Expire
+    double AllocationsPerOp() const {
+        return operations ? (double)(allocations - setup_allocations) / operations : 0.0;
+    }
+
+    // Marks the end of construction, the allocations made so far are not charged to the operations
+    void EndSetup(){
+        setup_allocations = allocations;
+    }
+};
+
+// Helper function for printing
+std::ostream& operator<< (std::ostream &out, const AllocationStats &s){
+    out << "Live:" << s.live_bytes << ", Peak:" << s.peak_bytes << ", Allocations:" << s.allocations - s.setup_allocations
+        << ", Deallocations:" << s.deallocations << ", Ops:" << s.operations << ", AllocsPerOp:" << s.AllocationsPerOp();
+    return out;
+}
+
+
+// An arena which backs containers with huge pages, for windows whose structures span gigabytes and would thrash the TLB.
+// Memory is mapped in regions of one huge page (2 MB or 1 GB), taken from the reserved hugetlbfs pages when there are any
+// (MAP_HUGETLB) and otherwise marked for transparent huge pages (MADV_HUGEPAGE). Each region is bound to a NUMA node, the
+// node of the thread mapping it unless one is given, before its pages are touched.
+// Blocks up to a quarter of a page, and at most 2 MB, are carved out of the regions and recycled through free lists of their
+// size, which are exact for the fixed size nodes of lists and hash tables. Larger blocks (vectors, bucket arrays) get regions
+// of their own, unmapped when they are freed. With 1 GB pages the blocks up to a quarter of a page get 2 MB pages, so that a
+// growing bucket array neither abandons the rest of a 1 GB region nor uses up the reserved 1 GB pages.
+// An arena is not thread safe, each thread allocates from its own.
+class HugePageArena{
+public:
+    static const std::size_t page_2m = 2UL << 20;
+    static const std::size_t page_1g = 1UL << 30;
+
+protected:
+    static const std::size_t granule = 16;  // Block sizes are rounded up to this, which is also their alignment
+    static const std::size_t small_classes = 256;  // Blocks up to small_classes * granule bytes have indexed free lists
+
+    std::size_t page_size;  // The huge page size
+    int node;  // The NUMA node to bind the regions to, -1 for the node of the mapping thread
+
+    std::vector<std::pair<char*, std::size_t> > regions;  // Every mapped region, unmapped with the arena
+    char * next;  // The unused part of the current region
+    char * end;
+    std::vector<void*> small_free;  // The free blocks of each small size, linked through their first word
+    std::map<std::size_t, void*> medium_free;  // The free blocks of the larger sizes carved out of the regions
+    std::map<void*, std::size_t> large;  // The blocks with a region of their own, and the region sizes
+
+    uint64_t hugetlb_regions;  // The regions backed by reserved huge pages
+    uint64_t thp_regions;  // The regions marked for transparent huge pages
+    uint64_t bound_regions;  // The regions bound to the NUMA node
+    uint64_t mapped_bytes;  // The bytes mapped
+
+public:
+    // Constructor, page_size is page_2m or page_1g, node is a NUMA node or -1 for the node of the thread mapping each region
+    HugePageArena(std::size_t page_size = page_2m, int node = -1)
+    :page_size(page_size), node(node), next(NULL), end(NULL), small_free(small_classes + 1, (void*)NULL),
+     hugetlb_regions(0), thp_regions(0), bound_regions(0), mapped_bytes(0) {}
+
+    ~HugePageArena(){
+        for(uint i=0; i<regions.size(); ++i)
+            munmap(regions[i].first, regions[i].second);
+    }
+
+    // Returns a block of at least bytes bytes
+    void * Allocate(std::size_t bytes){
+        bytes = Round(bytes);
+        if(IsLarge(bytes)){  // A region of its own
+            std::size_t page = (bytes > page_size / 4) ? page_size : (std::size_t)page_2m;
+            std::size_t size = (bytes + page - 1) / page * page;
+            char * p = Map(size, page);
+            large[p] = size;
+            return p;
+        }
+        void * & head = FreeList(bytes);
+        if(head != NULL){  // Recycle a free block
+            void * p = head;
+            head = *(void**)p;
+            return p;
+        }
+        if(next == NULL || (std::size_t)(end - next) < bytes){  // The rest of the current region is abandoned
+            next = Map(page_size, page_size);
+            end = next + page_size;
+        }
+        void * p = next;
+        next += bytes;
+        return p;
+    }
+
+    // Returns a block of bytes bytes, as allocated, to the arena
+    void Deallocate(void * p, std::size_t bytes){
+        bytes = Round(bytes);
+        if(IsLarge(bytes)){
+            std::map<void*, std::size_t>::iterator it = large.find(p);
+            for(uint i=0; i<regions.size(); ++i)
+                if(regions[i].first == p){
+                    regions.erase(regions.begin() + i);
+                    break;
+                }
+            munmap(p, it->second);
+            mapped_bytes -= it->second;
+            large.erase(it);
+            return;
+        }
+        void * & head = FreeList(bytes);
+        *(void**)p = head;
+        head = p;
+    }
+
+    std::size_t PageSize() const { return page_size; }
+    uint64_t HugeTlbRegions() const { return hugetlb_regions; }
+    uint64_t ThpRegions() const { return thp_regions; }
+    uint64_t BoundRegions() const { return bound_regions; }
+    uint64_t MappedBytes() const { return mapped_bytes; }
+
+protected:
+    static std::size_t Round(std::size_t bytes){
+        return (std::max<std::size_t>(bytes, sizeof(void*)) + granule - 1) / granule * granule;
+    }
+
+    // Returns whether a block gets a region of its own
+    bool IsLarge(std::size_t bytes) const {
+        return bytes > std::min(page_size / 4, (std::size_t)page_2m);
+    }
+
+    // Returns the free list of a block size
+    void * & FreeList(std::size_t bytes){
+        if(bytes / granule <= small_classes)
+            return small_free[bytes / granule];
+        std::map<std::size_t, void*>::iterator it = medium_free.find(bytes);
+        if(it == medium_free.end())
+            it = medium_free.insert(std::make_pair(bytes, (void*)NULL)).first;
+        return it->second;
+    }
+
+    // Maps a region of size bytes, a multiple of page (page_2m or page_1g), with huge pages bound to the NUMA node
+    char * Map(std::size_t size, std::size_t page){
+        int huge_flags = MAP_HUGETLB | ((page == page_1g) ? (30 << MAP_HUGE_SHIFT) : (21 << MAP_HUGE_SHIFT));
+        void * p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | huge_flags, -1, 0);
+        if(p != MAP_FAILED)
+            hugetlb_regions++;
+        else{  // No reserved huge pages, map page aligned memory and ask for transparent huge pages
+            p = mmap(NULL, size + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if(p == MAP_FAILED){
+                std::cout << "Error: Cannot map " << size << " bytes for the huge page arena" << std::endl;
+                ::exit(-1);
+            }
+            char * base = (char*)p;
+            char * aligned = (char*)(((uintptr_t)base + page - 1) / page * page);
+            if(aligned > base)  // Trim the unaligned head and tail
+                munmap(base, aligned - base);
+            if(aligned + size < base + size + page)
+                munmap(aligned + size, base + size + page - (aligned + size));
+            p = aligned;
+            if(madvise(p, size, MADV_HUGEPAGE) == 0)
+                thp_regions++;
+        }
+        if(Bind(p, size))
+            bound_regions++;
+        regions.push_back(std::make_pair((char*)p, size));
+        mapped_bytes += size;
+        return (char*)p;
+    }
+
+    // Binds a region to the NUMA node, before it is touched. Returns false if the system cannot.
+    bool Bind(void * p, std::size_t size){
+        unsigned cpu = 0, local = 0;
+        uint bind_node = (node >= 0) ? (uint)node : (syscall(SYS_getcpu, &cpu, &local, NULL) == 0 ? local : 0);
+        if(bind_node >= 64)
+            return false;
+        unsigned long mask = 1UL << bind_node;
+        return syscall(SYS_mbind, p, size, MPOL_BIND, &mask, 64, 0) == 0;
+    }
+};
+
+
+// An allocator which records the memory it hands out in an AllocationStats object.
+// Without a stats object (the default) it behaves exactly like std::allocator.
+// All containers of an algorithm share the algorithm's stats object, so its totals cover the whole data structure.
+// With an arena the memory comes from the arena's huge pages instead of operator new.
+template <class T>
+class TrackingAllocator{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <class U> struct rebind { typedef TrackingAllocator<U> other; };
+
+    AllocationStats * stats;  // The statistics to record into, NULL for none
+    HugePageArena * arena;  // The arena to allocate from, NULL for operator new
+
+    TrackingAllocator(AllocationStats * stats = NULL, HugePageArena * arena = NULL) : stats(stats), arena(arena) {}
+
+    template <class U>
+    TrackingAllocator(const TrackingAllocator<U> & other) : stats(other.stats), arena(other.arena) {}
+
+    pointer allocate(size_type n, const void * hint = 0){
+        if(stats != NULL){
+            stats->live_bytes += n * sizeof(T);
+            stats->allocations++;
+            if(stats->live_bytes > stats->peak_bytes)
+                stats->peak_bytes = stats->live_bytes;
+        }
+        if(arena != NULL)
+            return static_cast<pointer>(arena->Allocate(n * sizeof(T)));
+        return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, size_type n){
+        if(stats != NULL){
+            stats->live_bytes -= n * sizeof(T);
+            stats->deallocations++;
+        }
+        if(arena != NULL)
+            arena->Deallocate(p, n * sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    size_type max_size() const { return std::numeric_limits<size_type>::max() / sizeof(T); }
+    void construct(pointer p, const T & val){ new((void*)p) T(val); }
+    void destroy(pointer p){ p->~T(); }
+
+    template <class U>
+    bool operator==(const TrackingAllocator<U> & other) const { return stats == other.stats && arena == other.arena; }
+    template <class U>
+    bool operator!=(const TrackingAllocator<U> & other) const { return !(*this == other); }
+};
+
+#endif /* MEMORY_H_ */
@@ -23,6 +23,7 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 #define NETWORK_H_
 
 #include "Common.h"
+#include "Memory.h"
 
 class Flow; // Forward declaration
 typedef Flow* FlowP;  // A pointer to a Flow, used extensively
@@ -32,9 +33,10 @@ class Packet{
 public:
     FlowP flowp;  // The Flow that generated it
     uint seq_num; // Its sequence number
+    uint length;  // Its length in bytes on the wire (0 for generated packets)
 
-    Packet(FlowP flowp, uint seq_num)
-    :flowp(flowp), seq_num(seq_num){}
+    Packet(FlowP flowp, uint seq_num, uint length=0)
+    :flowp(flowp), seq_num(seq_num), length(length){}
 };
 
 // A Flow, generates Packets
@@ -42,16 +44,17 @@ class Flow {
 public:
     uint id;  // The Id of the Flow
     uint seq_num;  // The sequence number of the last packet sent
+    uint32_t addr;  // The source IPv4 address (the first 32 bits of an IPv6 one) in host order, for the prefix hierarchy
 
-    Flow(uint id)
-    :id(id)
+    Flow(uint id, uint32_t addr=0)
+    :id(id), addr(addr)
     {
         seq_num = 1;
     }
 
-    // Generate a new packet
-    Packet NewPacket() {
-        Packet p(this, seq_num);
+    // Generate a new packet, optionally of a given length on the wire
+    Packet NewPacket(uint length=0) {
+        Packet p(this, seq_num, length);
         seq_num++;
         return p;
     }
@@ -71,33 +74,40 @@ std::ostream& operator<< (std::ostream &out, Packet &p){
 }
 
 // A Queue based on std::deque but which has an upper bound on the items it can contain
-template <class T>
-class MaxQueue : public std::deque<T>{
+template <class T, class Alloc = std::allocator<T> >
+class MaxQueue : public std::deque<T, Alloc>{
 public:
     uint max_queue_size;
 
-    MaxQueue(uint max_queue_size)
-    :max_queue_size(max_queue_size) {}
+    MaxQueue(uint max_queue_size, const Alloc & alloc = Alloc())
+    :std::deque<T, Alloc>(alloc), max_queue_size(max_queue_size) {}
 
     // Modified method to limit the number of items in it.
     // In this implementation exceeding the limit is an error, i.e. dropped packet are not allowed.
     void push_back ( const T& x ){
-        if(std::deque<T>::size()>=max_queue_size){
+        if(std::deque<T, Alloc>::size()>=max_queue_size){
             std::cout << "Error: Queue size exceeded. This queue cannot handle more than " << max_queue_size << " items" << std::endl;
             ::exit(-1);
         }
-        std::deque<T>::push_back(x);
+        std::deque<T, Alloc>::push_back(x);
     }
 };
 
 
+// The queue of packets in the router, its allocator may take the memory from a HugePageArena
+typedef MaxQueue<Packet, TrackingAllocator<Packet> > PacketQueue;
+
 // Flow-Count and Count-Flow pairs and maps
 typedef std::pair< FlowP, uint> FlowCountPair;  // A pair of a Flow (pointer) and an integer count
 typedef std::pair< uint, FlowP> CountFlowPair;  // A pair of an integer count and a Flow (pointer)
 
-typedef boost::unordered_map<FlowP, uint> FlowCountMap;  // A map from a FlowP to an integer count
+typedef boost::unordered_map<FlowP, uint, boost::hash<FlowP>, std::equal_to<FlowP>,
+                             TrackingAllocator<std::pair<const FlowP, uint> > > FlowCountMap;  // A map from a FlowP to an integer count
 typedef std::vector<FlowCountPair> HittersQueryResult;  // A vector of FlowP-Count Pairs
 
+typedef std::pair<uint, uint> CountFlowsPair;  // A pair of a count and the number of flows with that count
+typedef std::vector<CountFlowsPair> FlowSizeHistogram;  // A vector of Count-Flows Pairs, in increasing count order
+
 
 // Helper overloaded operator for output
 std::ostream& operator<< (std::ostream &out, const FlowCountPair & fcp){
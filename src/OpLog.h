@@ -0,0 +1,301 @@
+/*
+OpLog.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPLOG_H_
+#define OPLOG_H_
+
+#include "Common.h"
+#include "Network.h"
+#include "Algorithm.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>  // For open()
+#include <unistd.h>  // For close()
+#include <sys/stat.h>  // For fstat()
+#include <sys/mman.h>  // For mmap()
+
+// An operation log records the exact sequence of Append/Expire/QueryHeaviest calls made on an Algorithm,
+// so that the same workload can be replayed directly on any algorithm, without the queue and packet generator.
+//
+// File layout (all integers little endian):
+//   Header   : OpLogHeader (64 bytes)
+//   Chunks   : chunk_count x { uint32 op_count, uint32 byte_count, byte_count bytes of encoded ops }
+//   Index    : chunk_count x { uint64 file offset of the chunk, uint64 number of the chunk's first op }
+//
+// Every op is one unsigned LEB128 varint token, whose two low bits are the op code:
+//   APPEND/EXPIRE : (zigzag(flow id - previous flow id of the same op code) << 2) | code
+//   QUERY         : (k << 2) | code
+// The previous flow ids are reset to 0 at the start of every chunk, so chunks decode independently.
+struct OpLogHeader{
+    char magic[8];  // "HLHOPLOG"
+    uint32_t version;  // The format version, currently 1
+    uint32_t flow_count;  // The number of flows, flow ids are in [1, flow_count]
+    uint32_t max_queue_size;  // The maximum queue size of the recorded experiment
+    uint32_t k_heaviest;  // The k of the recorded experiment
+    uint64_t op_count;  // The total number of recorded ops
+    uint64_t chunk_count;  // The number of chunks
+    uint64_t index_offset;  // The file offset of the chunk index
+    char reserved[16];
+};
+
+// The op codes of an operation log
+enum OpCode {OP_APPEND=0, OP_EXPIRE=1, OP_QUERY=2};
+
+
+// Records the operations of an experiment into an operation log file
+class OpLogWriter {
+    static const uint ops_per_chunk = 65536;  // The number of ops in a full chunk
+
+    FILE * file;  // The log file
+    std::string filename;  // The file name of the log
+    OpLogHeader header;  // The header, written again with the final counts on Close()
+    std::vector<unsigned char> chunk;  // The encoded ops of the current chunk
+    std::vector<uint64_t> index;  // The chunk index, pairs of file offset and first op number
+    uint chunk_ops;  // The number of ops in the current chunk
+    uint64_t offset;  // The current file offset
+    uint32_t prev_flow[2];  // The previous flow id for APPEND and EXPIRE, used in delta encoding
+
+public:
+    // Constructor, creates the log file. flow_count, max_queue_size and k are recorded in the header for the replayer.
+    OpLogWriter(const std::string & filename, uint flow_count, uint max_queue_size, uint k_heaviest)
+    :filename(filename), chunk_ops(0), offset(0)
+    {
+        file = fopen(filename.c_str(), "wb");
+        if(file == NULL){
+            std::cout << "Error: Cannot create operation log " << filename << std::endl;
+            ::exit(-1);
+        }
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "HLHOPLOG", 8);
+        header.version = 1;
+        header.flow_count = flow_count;
+        header.max_queue_size = max_queue_size;
+        header.k_heaviest = k_heaviest;
+        Write(&header, sizeof(header));  // Placeholder, rewritten on Close()
+
+        chunk.reserve(ops_per_chunk * 5);
+        prev_flow[0] = prev_flow[1] = 0;
+    }
+
+    ~OpLogWriter(){
+        Close();
+    }
+
+    // Records an Append of packet
+    void RecordAppend(const Packet & packet){
+        RecordFlowOp(OP_APPEND, packet.flowp->id);
+    }
+
+    // Records an Expire of packet
+    void RecordExpire(const Packet & packet){
+        RecordFlowOp(OP_EXPIRE, packet.flowp->id);
+    }
+
+    // Records a QueryHeaviest for k hitters
+    void RecordQuery(uint k){
+        PutVarint(((uint64_t)k << 2) | OP_QUERY);
+        EndOp();
+    }
+
+    // Flushes the last chunk, writes the index and the final header and closes the file
+    void Close(){
+        if(file == NULL)
+            return;
+        FlushChunk();
+        header.index_offset = offset;
+        header.chunk_count = index.size() / 2;
+        if(!index.empty())
+            Write(&index[0], index.size() * sizeof(uint64_t));
+        fseek(file, 0, SEEK_SET);
+        Write(&header, sizeof(header));
+        fclose(file);
+        file = NULL;
+    }
+
+protected:
+    // Encodes an APPEND or EXPIRE as a zigzag delta from the previous flow id of the same op
+    void RecordFlowOp(OpCode code, uint32_t flow_id){
+        int64_t delta = (int64_t)flow_id - (int64_t)prev_flow[code];
+        prev_flow[code] = flow_id;
+        uint64_t zigzag = (delta < 0) ? ((uint64_t)(-delta) << 1) - 1 : (uint64_t)delta << 1;
+        PutVarint((zigzag << 2) | code);
+        EndOp();
+    }
+
+    // Appends an unsigned LEB128 varint to the current chunk
+    void PutVarint(uint64_t v){
+        while(v >= 0x80){
+            chunk.push_back((unsigned char)(v | 0x80));
+            v >>= 7;
+        }
+        chunk.push_back((unsigned char)v);
+    }
+
+    // Counts an op and starts a new chunk when the current one is full
+    void EndOp(){
+        header.op_count++;
+        if(++chunk_ops == ops_per_chunk)
+            FlushChunk();
+    }
+
+    // Writes the current chunk and records it in the index
+    void FlushChunk(){
+        if(chunk_ops == 0)
+            return;
+        index.push_back(offset);
+        index.push_back(header.op_count - chunk_ops);
+        uint32_t chunk_header[2] = {chunk_ops, (uint32_t)chunk.size()};
+        Write(chunk_header, sizeof(chunk_header));
+        Write(&chunk[0], chunk.size());
+        chunk.clear();
+        chunk_ops = 0;
+        prev_flow[0] = prev_flow[1] = 0;
+    }
+
+    void Write(const void * buf, std::size_t len){
+        if(fwrite(buf, 1, len, file) != len){
+            std::cout << "Error: Cannot write operation log " << filename << std::endl;
+            ::exit(-1);
+        }
+        offset += len;
+    }
+};
+
+
+// Reads an operation log through a memory mapping and replays it directly on an Algorithm
+class OpLogReader {
+    std::string filename;  // The file name of the log
+    const unsigned char * data;  // The start of the memory mapped file
+    std::size_t size;  // The size of the memory mapped file
+    const OpLogHeader * header;  // The header of the log, in the mapping
+    const uint64_t * index;  // The chunk index, in the mapping
+
+    std::vector<Flow> flows;  // The flows referenced by the log, flow id i is flows[i-1]
+    HittersQueryResult results;  // Receives the query results, kept at class level to amortize allocation costs
+
+public:
+    // Constructor, maps the log and checks its header and index
+    OpLogReader(const std::string & filename)
+    :filename(filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if(fd < 0 || fstat(fd, &st) != 0){
+            std::cout << "Error: Cannot open operation log " << filename << std::endl;
+            ::exit(-1);
+        }
+        size = st.st_size;
+        void * addr = (size >= sizeof(OpLogHeader)) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if(addr == MAP_FAILED)
+            Fail("cannot map file");
+        data = (const unsigned char *)addr;
+        madvise((void*)data, size, MADV_SEQUENTIAL);
+
+        header = (const OpLogHeader *)data;
+        if(std::memcmp(header->magic, "HLHOPLOG", 8) != 0 || header->version != 1)
+            Fail("not an operation log");
+        if(header->index_offset > size || (size - header->index_offset) / 16 < header->chunk_count)
+            Fail("truncated index");
+        index = (const uint64_t *)(data + header->index_offset);
+        for(uint64_t c=0; c<header->chunk_count; ++c){  // Check every chunk lies within the file, so replay need not
+            uint64_t off = index[2*c];
+            if(off < sizeof(OpLogHeader) || off + 8 > header->index_offset ||
+               ChunkBytes(c) > header->index_offset - off - 8)
+                Fail("corrupt chunk index");
+        }
+
+        for(uint i=1; i<=header->flow_count; ++i)  // Create Flow objects
+            flows.push_back(Flow(i));
+        results.reserve(header->k_heaviest);
+    }
+
+    ~OpLogReader(){
+        munmap((void*)data, size);
+    }
+
+    const OpLogHeader & Header() const { return *header; }
+
+    // Replays every op of the log on algorithm
+    void Replay(Algorithm * algorithm){
+        for(uint64_t c=0; c<header->chunk_count; ++c)
+            ReplayChunk(c, algorithm);
+    }
+
+    // Replays the ops of one chunk on algorithm
+    void ReplayChunk(uint64_t c, Algorithm * algorithm){
+        const unsigned char * p = data + index[2*c] + 8;
+        const unsigned char * end = p + ChunkBytes(c);
+        uint32_t prev_flow[2] = {0, 0};
+        Flow * first = flows.empty() ? NULL : &flows[0];  // Flow id i is first[i - 1]
+        uint flow_count = header->flow_count;
+
+        while(p < end){
+            uint64_t token = *p++;
+            if(token & 0x80){  // Multi byte varint
+                token &= 0x7F;
+                uint shift = 7;
+                unsigned char b;
+                do{
+                    if(shift >= 64)  // More than 10 bytes
+                        Fail("bad varint");
+                    b = *p++;
+                    token |= (uint64_t)(b & 0x7F) << shift;
+                    shift += 7;
+                }while((b & 0x80) && p < end);
+            }
+
+            uint code = token & 3;
+            uint64_t arg = token >> 2;
+            if(code == OP_QUERY){
+                results.clear();
+                algorithm->QueryHeaviest((uint)arg, results);
+                continue;
+            }else if(code > OP_QUERY)
+                Fail("bad op code");
+            uint32_t flow_id = prev_flow[code] + (uint32_t)((arg >> 1) ^ (0 - (arg & 1)));  // Undo zigzag and delta
+            prev_flow[code] = flow_id;
+            if(flow_id == 0 || flow_id > flow_count)
+                Fail("flow id out of range");
+            Packet packet(&first[flow_id - 1], 0);
+            if(code == OP_APPEND)
+                algorithm->Append(packet);
+            else
+                algorithm->Expire(packet);
+        }
+    }
+
+protected:
+    uint32_t ChunkBytes(uint64_t c) const {
+        uint32_t chunk_header[2];
+        std::memcpy(chunk_header, data + index[2*c], 8);
+        return chunk_header[1];
+    }
+
+    void Fail(const char * reason) const {
+        std::cout << "Error: Cannot read operation log " << filename << ": " << reason << std::endl;
+        ::exit(-1);
+    }
+};
+
+#endif /* OPLOG_H_ */
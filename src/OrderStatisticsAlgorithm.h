@@ -0,0 +1,209 @@
+/*
+OrderStatisticsAlgorithm.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ORDERSTATISTICSALGORITHM_H_
+#define ORDERSTATISTICSALGORITHM_H_
+
+#include "Common.h"
+#include "Algorithm.h"
+
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+// Heaviest Hitters algorithm keeping the flows in an order statistics tree (the GNU policy based red-black tree) sorted on their counts.
+// Append and Expire move a flow in O(log F), QueryHeaviest is O(log F + k) and Rank and the quantiles are O(log F).
+class OrderStatisticsAlgorithm : public Algorithm {
+protected:
+    typedef std::pair<uint, uint> CountIdKey;  // A count and a flow id, the id makes the keys of equal counts unique
+    typedef __gnu_pbds::tree<CountIdKey, FlowP, std::less<CountIdKey>, __gnu_pbds::rb_tree_tag,
+                             __gnu_pbds::tree_order_statistics_node_update> CountTree;  // The tree type, lightest first
+    typedef CountTree::iterator CountTreeIt;
+
+    // The memory usage of flow_count_dict, recorded when tracking is enabled.
+    // The tree's allocators are static members of the policy based containers, so its nodes are not recorded.
+    AllocationStats memory;
+    bool track_memory;  // Whether the memory usage and the operations are recorded
+
+    FlowCountMap flow_count_dict;  // The count of each flow, to find its key in the tree
+    CountTree tree;  // Every counted flow, keyed by its count
+    uint total_count;  // The sum of the counts
+    uint distinct_counts;  // The number of distinct counts
+
+public:
+    // Constructor, track_memory enables recording the memory usage of the map
+    OrderStatisticsAlgorithm(bool track_memory = false)
+    :track_memory(track_memory), flow_count_dict(FlowCountMap::allocator_type(track_memory ? &memory : NULL)), total_count(0), distinct_counts(0)
+    {
+        memory.EndSetup();
+    }
+
+    // Executed when a new item is received
+    virtual void Append(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count++;
+        FlowCountMap::iterator it = flow_count_dict.find(packet.flowp);
+        if(it == flow_count_dict.end())
+            it = flow_count_dict.insert(FlowCountPair(packet.flowp, 0)).first;
+        else
+            Remove(packet.flowp, it->second);
+        Insert(packet.flowp, ++(it->second));
+    }
+
+    // Executed when an item is served
+    virtual void Expire(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count--;
+        FlowCountMap::iterator it = flow_count_dict.find(packet.flowp);
+        Remove(packet.flowp, it->second);
+        if(--(it->second) > 0)
+            Insert(packet.flowp, it->second);
+        else
+            flow_count_dict.erase(it);
+    }
+
+    // Returns the memory usage of flow_count_dict
+    virtual AllocationStats MemoryStats(){
+        return memory;
+    }
+
+    // Calculates and returns the k Heaviest Hitters in the provided result container, walking down from the heaviest key
+    virtual void QueryHeaviest(uint k, HittersQueryResult & result){
+        CountTreeIt it = tree.end();
+        for(uint i=0; i<k && it!=tree.begin(); ++i){
+            --it;
+            result.push_back(FlowCountPair(it->second, it->first.first));
+        }
+    }
+
+    // Writes the flows with a count of at least c, heaviest first, into result (at most max_results) and returns their number
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results){
+        uint n = 0;
+        CountTreeIt it = tree.end();
+        while(n<max_results && it!=tree.begin()){
+            --it;
+            if(it->first.first < c)
+                break;
+            result[n++] = FlowCountPair(it->second, it->first.first);
+        }
+        return n;
+    }
+
+    // Returns the number of packets currently counted
+    virtual uint TotalCount(){
+        return total_count;
+    }
+
+    // Returns the count of a flow, 0 if it is not counted
+    virtual uint GetCount(FlowP flowp){
+        FlowCountMap::iterator it = flow_count_dict.find(flowp);
+        return (it != flow_count_dict.end()) ? it->second : 0;
+    }
+
+    // Returns 1 + the number of flows with a greater count than flowp, 0 if it is not counted. O(log F).
+    virtual uint Rank(FlowP flowp){
+        uint count = GetCount(flowp);
+        if(count == 0)
+            return 0;
+        return 1 + tree.size() - tree.order_of_key(CountIdKey(count + 1, 0));
+    }
+
+    // Returns the number of flows at each count in the provided result container, jumping over the keys of each count
+    virtual void QueryHistogram(FlowSizeHistogram & result){
+        CountTreeIt it = tree.begin();
+        while(it != tree.end()){
+            uint count = it->first.first;
+            uint first = tree.order_of_key(it->first);
+            it = tree.lower_bound(CountIdKey(count + 1, 0));
+            uint end = (it != tree.end()) ? tree.order_of_key(it->first) : tree.size();
+            result.push_back(CountFlowsPair(count, end - first));
+        }
+    }
+
+    // Returns the number of distinct counts among the flows. O(1).
+    virtual uint DistinctCounts(){
+        return distinct_counts;
+    }
+
+    // Returns the count of the flow at position ceil(q*flows) in increasing count order, 0 if no flows are counted. O(log F).
+    virtual uint FlowSizeQuantile(double q){
+        if(tree.empty())
+            return 0;
+        return tree.find_by_order(QuantilePosition(q, tree.size()) - 1)->first.first;
+    }
+
+    // Returns the Shannon entropy in bits of the distribution of the counted packets over the flows
+    virtual double FlowSizeEntropy(){
+        FlowSizeHistogram histogram;
+        QueryHistogram(histogram);
+        double entropy = 0.0;
+        foreach(CountFlowsPair & cf, histogram)
+            entropy += EntropyTerm(cf.first, cf.second, total_count);
+        return entropy;
+    }
+
+    // Empties the map and the tree, the map keeps its buckets
+    virtual bool Reset(){
+        flow_count_dict.clear();
+        tree.clear();
+        total_count = 0;
+        distinct_counts = 0;
+        memory.Restart();
+        return true;
+    }
+
+    // Rebuilds the tree from n flows, heaviest first, on an empty algorithm
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        if(!flow_count_dict.empty())
+            return false;
+        for(uint i=0; i<n; ++i){
+            if(flows[i].second == 0 || !flow_count_dict.insert(flows[i]).second)
+                return false;
+            Insert(flows[i].first, flows[i].second);
+            total_count += flows[i].second;
+        }
+        return true;
+    }
+
+protected:
+    // Returns true if some flow in the tree has the count
+    bool HasCount(uint count){
+        CountTreeIt it = tree.lower_bound(CountIdKey(count, 0));
+        return it != tree.end() && it->first.first == count;
+    }
+
+    // Adds a flow with a count to the tree
+    void Insert(FlowP flowp, uint count){
+        if(!HasCount(count))
+            distinct_counts++;
+        tree.insert(std::make_pair(CountIdKey(count, flowp->id), flowp));
+    }
+
+    // Removes a flow with a count from the tree
+    void Remove(FlowP flowp, uint count){
+        tree.erase(CountIdKey(count, flowp->id));
+        if(!HasCount(count))
+            distinct_counts--;
+    }
+};
+
+#endif /* ORDERSTATISTICSALGORITHM_H_ */
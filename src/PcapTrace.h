@@ -0,0 +1,403 @@
+/*
+PcapTrace.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PCAPTRACE_H_
+#define PCAPTRACE_H_
+
+#include "Common.h"
+#include "Network.h"
+
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>  // For open()
+#include <unistd.h>  // For close()
+#include <sys/stat.h>  // For fstat()
+#include <sys/mman.h>  // For mmap()
+
+// The key of a flow in a trace: the classic 5-tuple.
+// IPv4 addresses are stored in the first word of the address arrays, the other words are zero.
+struct FiveTuple{
+    uint32_t src[4];  // Source address (raw network order words)
+    uint32_t dst[4];  // Destination address (raw network order words)
+    uint16_t sport, dport;  // Source and destination ports in network order (zero when there is no transport header)
+    uint8_t proto;  // The IP protocol number
+    uint8_t version;  // The IP version, 4 or 6
+    uint16_t pad;  // Always zero, so that the whole struct can be hashed and compared as raw words
+
+    void Clear(){ std::memset(this, 0, sizeof(FiveTuple)); }
+
+    bool operator==(const FiveTuple & o) const { return std::memcmp(this, &o, sizeof(FiveTuple)) == 0; }
+};
+
+// Hashes a FiveTuple by mixing its raw 64 bit words (a cheap multiply-xorshift mixer)
+struct FiveTupleHash{
+    std::size_t operator()(const FiveTuple & t) const {
+        uint64_t words[sizeof(FiveTuple)/8];
+        std::memcpy(words, &t, sizeof(FiveTuple));
+        uint64_t h = 0x9E3779B97F4A7C15ULL;
+        for(uint i=0; i<sizeof(FiveTuple)/8; ++i){
+            h ^= words[i];
+            h *= 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 31;
+        }
+        return (std::size_t)h;
+    }
+};
+
+
+// A packet trace read from a pcap or pcapng file.
+// The file is memory mapped and the packet headers (Ethernet/VLAN, Linux SLL, IPv4, IPv6, TCP/UDP/SCTP) are parsed in place,
+// without copying. Each packet is mapped to a Flow by its 5-tuple, and its wire length is recorded in Packet::length.
+class PcapTrace {
+protected:
+    // Link layer types (see http://www.tcpdump.org/linktypes.html)
+    enum LinkType {LINKTYPE_NULL=0, LINKTYPE_ETHERNET=1, LINKTYPE_RAW_OLD=12, LINKTYPE_RAW=101, LINKTYPE_LINUX_SLL=113, LINKTYPE_LINUX_SLL2=276};
+    enum Format {PCAP, PCAPNG};
+
+    typedef boost::unordered_map<FiveTuple, FlowP, FiveTupleHash> FlowTable;  // Maps 5-tuples to flows
+
+    std::string filename;  // The file name of the trace
+    const unsigned char * data;  // The start of the memory mapped file
+    std::size_t size;  // The size of the memory mapped file
+    Format format;  // The file format
+    bool swapped;  // True if the file (or current pcapng section) was written with the opposite byte order
+    std::vector<uint> if_linktypes;  // The link type of each interface in the current pcapng section (one entry for pcap)
+
+    std::size_t pos;  // The offset of the next record in the file
+    std::size_t first_pos;  // The offset of the first record in the file
+    uint packet_count;  // The number of IP packets in the trace
+    uint skipped_count;  // The number of records which were not IP packets and are skipped
+
+    std::deque<Flow> flows;  // The flows of the trace. A deque so that FlowP pointers stay valid as it grows.
+    FlowTable flowtable;  // The 5-tuple to flow map
+
+public:
+    // Constructor, maps the file and performs a first pass over it to discover the packets and flows.
+    PcapTrace(const std::string & filename)
+    :filename(filename), data(NULL), size(0), swapped(false), pos(0), first_pos(0), packet_count(0), skipped_count(0)
+    {
+        Map();
+        Rewind();
+
+        // Discover all flows before replaying, so that the flow table never grows during a timed run
+        FiveTuple key;
+        uint length;
+        while(NextKey(key, length)){
+            packet_count++;
+            Resolve(key);
+        }
+        if(packet_count == 0){
+            std::cout << "Error: Trace " << filename << " contains no IPv4/IPv6 packets" << std::endl;
+            ::exit(-1);
+        }
+        madvise((void*)data, size, MADV_SEQUENTIAL);  // Replay reads the file front to back
+        Rewind();
+    }
+
+    ~PcapTrace(){
+        munmap((void*)data, size);
+    }
+
+    // Returns the number of IP packets in the trace
+    uint PacketCount() const { return packet_count; }
+
+    // Returns the number of non IP records which are skipped
+    uint SkippedCount() const { return skipped_count; }
+
+    // Returns the number of distinct flows in the trace
+    uint FlowCount() const { return flows.size(); }
+
+    // Returns the flow with the given id, in [1, FlowCount()]
+    FlowP GetFlow(uint id) { return &flows[id-1]; }
+
+    // Restart the replay from the first packet
+    void Rewind(){
+        ReadFileHeader();
+        pos = first_pos;
+    }
+
+    // Returns the next packet of the trace. The trace is replayed cyclically when its end is reached.
+    Packet NextPacket(){
+        FiveTuple key;
+        uint length;
+        if(!NextKey(key, length)){  // End of trace, start over
+            Rewind();
+            NextKey(key, length);
+        }
+        return Resolve(key)->NewPacket(length);
+    }
+
+protected:
+    // Memory maps the whole trace file read only
+    void Map(){
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat st;
+        if(fd < 0 || fstat(fd, &st) != 0){
+            std::cout << "Error: Cannot open trace " << filename << std::endl;
+            ::exit(-1);
+        }
+        size = st.st_size;
+        void * addr = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if(addr == MAP_FAILED){
+            std::cout << "Error: Cannot map trace " << filename << std::endl;
+            ::exit(-1);
+        }
+        data = (const unsigned char *)addr;
+    }
+
+    // Reads unaligned integers in the file's byte order
+    uint16_t Read16(const unsigned char * p) const {
+        uint16_t v; std::memcpy(&v, p, 2);
+        return swapped ? __builtin_bswap16(v) : v;
+    }
+    uint32_t Read32(const unsigned char * p) const {
+        uint32_t v; std::memcpy(&v, p, 4);
+        return swapped ? __builtin_bswap32(v) : v;
+    }
+
+    // Reads unaligned big endian (network order) integers
+    static uint16_t ReadNet16(const unsigned char * p) { return (uint16_t)((p[0] << 8) | p[1]); }
+    static uint32_t ReadNet32(const unsigned char * p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+    // Detects the file format and byte order and finds the offset of the first record
+    void ReadFileHeader(){
+        if(size < 24)
+            Fail("file too small");
+        uint32_t magic;
+        std::memcpy(&magic, data, 4);
+        if_linktypes.clear();
+        if(magic == 0xA1B2C3D4 || magic == 0xA1B23C4D || magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1){  // pcap, micro or nanosecond timestamps
+            format = PCAP;
+            swapped = (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1);
+            if_linktypes.push_back(Read32(data + 20) & 0x0FFFFFFF);  // The upper bits may hold FCS information
+            first_pos = 24;
+        }else if(magic == 0x0A0D0D0A){  // pcapng, starts with a Section Header Block
+            format = PCAPNG;
+            first_pos = 0;
+        }else
+            Fail("not a pcap or pcapng file");
+    }
+
+    // Reads the next record of the file, skipping non packet pcapng blocks.
+    // Returns false at the end of the file.
+    bool NextRecord(const unsigned char * & frame, uint & caplen, uint & wirelen, uint & linktype){
+        if(format == PCAP){
+            if(pos + 16 > size)
+                return false;
+            caplen = Read32(data + pos + 8);
+            wirelen = Read32(data + pos + 12);
+            frame = data + pos + 16;
+            linktype = if_linktypes[0];
+            if(caplen > size - pos - 16)
+                return false;  // Truncated last record
+            pos += 16 + caplen;
+            return true;
+        }
+
+        while(pos + 12 <= size){
+            const unsigned char * block = data + pos;
+            uint32_t type;
+            std::memcpy(&type, block, 4);  // The SHB type is a palindrome, it reads the same in either byte order
+            if(type == 0x0A0D0D0A){  // Section Header Block, sets the byte order of the section
+                uint32_t bom;
+                std::memcpy(&bom, block + 8, 4);
+                if(bom == 0x1A2B3C4D) swapped = false;
+                else if(bom == 0x4D3C2B1A) swapped = true;
+                else Fail("bad pcapng byte order magic");
+                if_linktypes.clear();
+            }else
+                type = Read32(block);
+
+            uint32_t blocklen = Read32(block + 4);
+            if(blocklen < 12 || blocklen > size - pos)
+                return false;  // Truncated or corrupt block, stop here
+            pos += blocklen;
+
+            switch(type){
+            case 1:  // Interface Description Block
+                if(blocklen >= 20)
+                    if_linktypes.push_back(Read16(block + 8));
+                break;
+            case 6:{  // Enhanced Packet Block
+                if(blocklen < 32) break;
+                uint if_id = Read32(block + 8);
+                caplen = Read32(block + 20);
+                wirelen = Read32(block + 24);
+                if(if_id >= if_linktypes.size() || caplen > blocklen - 32) break;
+                frame = block + 28;
+                linktype = if_linktypes[if_id];
+                return true;
+            }
+            case 3:{  // Simple Packet Block, always from the first interface
+                if(blocklen < 16 || if_linktypes.empty()) break;
+                wirelen = Read32(block + 8);
+                caplen = std::min(wirelen, blocklen - 16);
+                frame = block + 12;
+                linktype = if_linktypes[0];
+                return true;
+            }
+            case 2:{  // (Obsolete) Packet Block
+                if(blocklen < 32) break;
+                uint if_id = Read16(block + 8);
+                caplen = Read32(block + 20);
+                wirelen = Read32(block + 24);
+                if(if_id >= if_linktypes.size() || caplen > blocklen - 32) break;
+                frame = block + 28;
+                linktype = if_linktypes[if_id];
+                return true;
+            }
+            default:  // Any other block is skipped
+                break;
+            }
+        }
+        return false;
+    }
+
+    // Reads the next IP packet of the file and extracts its 5-tuple and wire length.
+    // Returns false at the end of the file.
+    bool NextKey(FiveTuple & key, uint & length){
+        const unsigned char * frame;
+        uint caplen, linktype;
+        while(NextRecord(frame, caplen, length, linktype)){
+            if(ParseKey(frame, caplen, linktype, key))
+                return true;
+            skipped_count++;
+        }
+        return false;
+    }
+
+    // Parses the link, network and transport headers of a frame in place.
+    // Returns false if the frame does not carry an IPv4/IPv6 packet.
+    static bool ParseKey(const unsigned char * p, uint caplen, uint linktype, FiveTuple & key){
+        const unsigned char * end = p + caplen;
+        uint ethertype;
+
+        switch(linktype){
+        case LINKTYPE_ETHERNET:
+            if(caplen < 14) return false;
+            ethertype = ReadNet16(p + 12);
+            p += 14;
+            while(ethertype == 0x8100 || ethertype == 0x88A8 || ethertype == 0x9100){  // Skip (stacked) VLAN tags
+                if(end - p < 4) return false;
+                ethertype = ReadNet16(p + 2);
+                p += 4;
+            }
+            break;
+        case LINKTYPE_LINUX_SLL:
+            if(caplen < 16) return false;
+            ethertype = ReadNet16(p + 14);
+            p += 16;
+            break;
+        case LINKTYPE_LINUX_SLL2:
+            if(caplen < 20) return false;
+            ethertype = ReadNet16(p);
+            p += 20;
+            break;
+        case LINKTYPE_NULL:{  // A 4 byte address family in the byte order of the capturing host
+            if(caplen < 4) return false;
+            uint family = p[0] | p[1] | p[2] | p[3];  // The family value fits in one byte, in either byte order
+            ethertype = (family == 2) ? 0x0800 : (family == 24 || family == 28 || family == 30) ? 0x86DD : 0;
+            p += 4;
+            break;
+        }
+        case LINKTYPE_RAW:
+        case LINKTYPE_RAW_OLD:
+            if(caplen < 1) return false;
+            ethertype = ((p[0] >> 4) == 6) ? 0x86DD : 0x0800;
+            break;
+        default:
+            return false;
+        }
+
+        key.Clear();
+        const unsigned char * l4 = NULL;  // The transport header, NULL if absent or not the first fragment
+
+        if(ethertype == 0x0800){  // IPv4
+            if(end - p < 20 || (p[0] >> 4) != 4) return false;
+            uint ihl = (p[0] & 0x0F) * 4;
+            if(ihl < 20) return false;
+            key.version = 4;
+            key.proto = p[9];
+            std::memcpy(&key.src[0], p + 12, 4);
+            std::memcpy(&key.dst[0], p + 16, 4);
+            if((ReadNet16(p + 6) & 0x1FFF) == 0 && ihl <= (std::size_t)(end - p))  // Only the first fragment carries the ports
+                l4 = p + ihl;
+        }else if(ethertype == 0x86DD){  // IPv6
+            if(end - p < 40 || (p[0] >> 4) != 6) return false;
+            key.version = 6;
+            std::memcpy(key.src, p + 8, 16);
+            std::memcpy(key.dst, p + 24, 16);
+            uint nh = p[6];
+            std::size_t off = 40;  // The offset of the next header from p, never past the captured bytes
+            std::size_t rest = end - p;  // The captured bytes from the IPv6 header on
+            bool found = true;  // Whether the transport header was reached, within the captured bytes
+            for(uint i=0; i<8; ++i){  // Skip a bounded number of extension headers
+                if(nh != 0 && nh != 43 && nh != 60 && nh != 44 && nh != 51)
+                    break;
+                if(off + 8 > rest) { found = false; break; }  // Every extension header has at least 8 bytes
+                const unsigned char * h = p + off;
+                std::size_t len;
+                if(nh == 44){  // Fragment
+                    if((ReadNet16(h + 2) & 0xFFF8) != 0) { nh = h[0]; found = false; break; }  // Not the first fragment
+                    len = 8;
+                }else if(nh == 51)  // Authentication header
+                    len = (h[1] + 2) * 4;
+                else  // Hop-by-hop, Routing, Destination options
+                    len = (h[1] + 1) * 8;
+                nh = h[0];
+                if(len > rest - off) { found = false; break; }  // Truncated by the capture
+                off += len;
+            }
+            key.proto = nh;
+            if(found)
+                l4 = p + off;
+        }else
+            return false;
+
+        // TCP, UDP, DCCP, SCTP and UDP-Lite all start with the two ports
+        if(l4 != NULL && end - l4 >= 4 &&
+           (key.proto == 6 || key.proto == 17 || key.proto == 33 || key.proto == 132 || key.proto == 136)){
+            std::memcpy(&key.sport, l4, 2);
+            std::memcpy(&key.dport, l4 + 2, 2);
+        }
+        return true;
+    }
+
+    // Returns the flow of a 5-tuple, creating it on first sight
+    FlowP Resolve(const FiveTuple & key){
+        FlowTable::iterator it = flowtable.find(key);
+        if(it != flowtable.end())
+            return it->second;
+        flows.push_back(Flow(flows.size()+1, ReadNet32((const unsigned char *)key.src)));
+        FlowP flowp = &flows.back();
+        flowtable[key] = flowp;
+        return flowp;
+    }
+
+    // Reports a malformed trace and exits
+    void Fail(const char * reason) const {
+        std::cout << "Error: Cannot read trace " << filename << ": " << reason << std::endl;
+        ::exit(-1);
+    }
+};
+
+#endif /* PCAPTRACE_H_ */
@@ -0,0 +1,282 @@
+/*
+PipelineExperiment.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PIPELINEEXPERIMENT_H_
+#define PIPELINEEXPERIMENT_H_
+
+#include "Common.h"
+#include "Experiment.h"
+#include "Platform.h"
+
+#include <boost/thread.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
+// An Experiment whose stages run on separate threads, as classification and accounting run on separate cores in a router:
+// the generator creates the packets, the queue stage appends them to the MaxQueue and serves it, and the algorithm stage
+// runs Append, Expire and the scheduled queries. The stages are connected by lock-free single producer single consumer rings,
+// which they write and read in batches of Params::pipeline_batch items, and a stage waits while its output ring is full.
+// The packets and the operations are the same as in UniformExperiment(). Each stage's throughput is measured, and the
+// end-to-end latency of every packet from its generation to its Append.
+class PipelineExperiment : public Experiment {
+protected:
+    // A packet on its way through the pipeline, or a queue operation
+    struct PipelineOp{
+        Packet packet;
+        uint64_t born_ns;  // When the packet was generated
+        bool append;  // Whether the packet is appended, otherwise it is served
+
+        PipelineOp()
+        :packet(NULL, 0), born_ns(0), append(false) {}
+        PipelineOp(const Packet & packet, uint64_t born_ns, bool append)
+        :packet(packet), born_ns(born_ns), append(append) {}
+    };
+    typedef boost::lockfree::spsc_queue<PipelineOp> OpRing;
+
+    static const uint ring_size = 8192;  // The capacity of each ring
+
+    // Writes items to a ring in batches
+    class BatchWriter{
+        OpRing & ring;
+        std::vector<PipelineOp> batch;
+        uint size;
+        StageStats & stats;
+    public:
+        BatchWriter(OpRing & ring, uint size, StageStats & stats)
+        :ring(ring), size(size), stats(stats) { batch.reserve(size); }
+
+        // Adds an item, writing the batch once it is full
+        void Push(const PipelineOp & op){
+            batch.push_back(op);
+            stats.items++;
+            if(batch.size() >= size)
+                Flush();
+        }
+
+        // Writes the batch, waiting while the ring is full
+        void Flush(){
+            for(uint done = 0; done < batch.size();){
+                done += ring.push(&batch[done], batch.size() - done);
+                if(done < batch.size()){
+                    stats.stalls++;
+                    boost::this_thread::yield();
+                }
+            }
+            batch.clear();
+        }
+    };
+
+    // Reads items from a ring in batches
+    class BatchReader{
+        OpRing & ring;
+        std::vector<PipelineOp> batch;
+        uint next, count;
+        StageStats & stats;
+    public:
+        BatchReader(OpRing & ring, uint size, StageStats & stats)
+        :ring(ring), batch(size), next(0), count(0), stats(stats) {}
+
+        // Returns the next item, waiting while the ring is empty
+        const PipelineOp & Pop(){
+            while(next == count){
+                count = ring.pop(&batch[0], batch.size());
+                next = 0;
+                if(count == 0){
+                    stats.starves++;
+                    boost::this_thread::yield();
+                }
+            }
+            return batch[next++];
+        }
+    };
+
+    OpRing packets_ring;  // From the generator to the queue stage
+    OpRing ops_ring;  // From the queue stage to the algorithm stage
+    uint appends;  // The number of packets the experiment appends
+
+    StageStats generator_stats, queue_stats, algorithm_stats;
+    LatencyRecorder end_to_end;  // The latencies from the generation of the packets to their Append
+
+public:
+    // Constructor, the stages start in PipelineRun()
+    PipelineExperiment(Params p)
+    :Experiment(p), packets_ring(ring_size), ops_ring(ring_size)
+    {
+        appends = AppendCount();
+    }
+
+    // Runs the experiment from start to finish, each stage on its own thread
+    void PipelineRun(){
+        boost::thread generator(boost::bind(&PipelineExperiment::GeneratorStage, this));
+        boost::thread queuer(boost::bind(&PipelineExperiment::QueueStage, this));
+        boost::thread accounter(boost::bind(&PipelineExperiment::AlgorithmStage, this));
+        generator.join();
+        queuer.join();
+        accounter.join();
+        iteration = 2 * appends;  // Every appended packet is also served
+    }
+
+    const StageStats & GetGeneratorStats(){
+        return generator_stats;
+    }
+
+    const StageStats & GetQueueStats(){
+        return queue_stats;
+    }
+
+    const StageStats & GetAlgorithmStats(){
+        return algorithm_stats;
+    }
+
+    const LatencyRecorder & GetEndToEndLatency(){
+        return end_to_end;
+    }
+
+    // Helper function for executing a pipelined experiment multiple times and collecting statistics
+    static void RunPipeline(Experiment::Params params, uint times);
+
+protected:
+    // Returns the number of packets UniformExperiment() appends: it fills the queue, then serves and appends one packet
+    // at a time until seq_size operations are done, counting both
+    uint AppendCount(){
+        uint n = std::min(params.max_queue_size, params.seq_size);
+        if(params.seq_size > 2 * params.max_queue_size)
+            n += (params.seq_size - 2 * params.max_queue_size + 1) / 2;
+        return n;
+    }
+
+    // Pins the calling stage to the i-th of the pipeline cores, if they are given
+    void Pin(uint i){
+        if(i < params.pipeline_cores.size() && !PinToCore(params.pipeline_cores[i]))
+            std::cout << "Warning: Cannot pin the pipeline stage " << i << " to core " << params.pipeline_cores[i] << std::endl;
+    }
+
+    // Generates the packets
+    void GeneratorStage(){
+        Pin(0);
+        BatchWriter out(packets_ring, params.pipeline_batch, generator_stats);
+        generator_stats.start_ns = LatencyRecorder::Now();
+        for(uint i=0; i<appends; ++i){
+            Packet packet = NextPacket();
+            out.Push(PipelineOp(packet, LatencyRecorder::Now(), true));
+        }
+        out.Flush();
+        generator_stats.end_ns = LatencyRecorder::Now();
+    }
+
+    // Appends the packets to the queue, serving the front packet first when it is full, and then drains it
+    void QueueStage(){
+        Pin(1);
+        BatchReader in(packets_ring, params.pipeline_batch, queue_stats);
+        BatchWriter out(ops_ring, params.pipeline_batch, queue_stats);
+        queue_stats.start_ns = LatencyRecorder::Now();
+        for(uint i=0; i<appends; ++i){
+            const PipelineOp & op = in.Pop();
+            if(queue.size() >= params.max_queue_size){
+                out.Push(PipelineOp(queue.front(), 0, false));
+                queue.pop_front();
+            }
+            queue.push_back(op.packet);
+            out.Push(op);
+        }
+        while(queue.size() > 0){
+            out.Push(PipelineOp(queue.front(), 0, false));
+            queue.pop_front();
+        }
+        out.Flush();
+        queue_stats.end_ns = LatencyRecorder::Now();
+    }
+
+    // Runs the algorithm on the queue operations, with the scheduled queries after the appends
+    void AlgorithmStage(){
+        Pin(2);
+        BatchReader in(ops_ring, params.pipeline_batch, algorithm_stats);
+        algorithm_stats.start_ns = LatencyRecorder::Now();
+        for(uint i=0; i<2*appends; ++i){
+            PipelineOp op = in.Pop();
+            if(!op.append){
+                algorithm->Expire(op.packet);
+                algorithm_stats.items++;
+                continue;
+            }
+            ++packets;
+            algorithm->Append(op.packet);
+            ScheduledQuery();
+            algorithm_stats.items++;
+            end_to_end.Record(LatencyRecorder::Now() - op.born_ns);
+        }
+        algorithm_stats.end_ns = LatencyRecorder::Now();
+    }
+};
+
+// Helper function for executing a pipelined experiment multiple times and collecting statistics
+void PipelineExperiment::RunPipeline(Experiment::Params params, uint times){
+    MultiShotTimer timer;
+    Experiment::Params ran = params;
+    uint packets = 0;
+    AllocationStats memory;
+    std::vector<LatencyRecorder> latencies;  // The query latencies of each repetition
+    std::vector<StageStats> generator, queuer, accounter;  // The stages of each repetition
+    std::vector<LatencyRecorder> end_to_end;  // The end-to-end latencies of each repetition
+    for(uint i = 0; i < times; i++){
+        PipelineExperiment exp(params);
+        timer.Start();
+        exp.PipelineRun();
+        timer.Stop();
+        ran = exp.GetParams();
+        packets = exp.GetPacketCount();
+        memory = exp.GetCurrentAlgorithm()->MemoryStats();
+        latencies.push_back(exp.GetQueryLatency());
+        generator.push_back(exp.GetGeneratorStats());
+        queuer.push_back(exp.GetQueueStats());
+        accounter.push_back(exp.GetAlgorithmStats());
+        end_to_end.push_back(exp.GetEndToEndLatency());
+    }
+
+    if(params.output_format == TEXT){
+        std::cout << "Ran as: " << ran << ", Execution Time Statistics: " << timer;
+        if(params.memory_stats)
+            std::cout << ", Memory Statistics: " << memory;
+        if(params.query_mode != QUERY_PACKET)
+            std::cout << ", Query Latency Statistics: " << latencies.back();
+        std::cout << ", Generator Stage: " << generator.back() << ", Queue Stage: " << queuer.back() << ", Algorithm Stage: " << accounter.back()
+                  << ", End-to-End Latency Statistics: " << end_to_end.back() << std::endl;
+        return;
+    }
+
+    // The rows have the whole pipeline's time, the generation and queueing run in parallel so no baseline is subtracted
+    static bool header_written = false;
+    ResultWriter writer(std::cout, params.output_format);
+    if(!header_written){
+        writer.Header();
+        header_written = true;
+    }
+    for(uint i = 0; i < times; i++){
+        ResultRow row(ran, i+1, timer.Duration(i), packets, 0.0, memory);
+        row.latency = latencies[i];
+        row.generator = generator[i];
+        row.queuer = queuer[i];
+        row.accounter = accounter[i];
+        row.end_to_end = end_to_end[i];
+        writer.Row(row);
+    }
+}
+
+#endif /* PIPELINEEXPERIMENT_H_ */
@@ -0,0 +1,151 @@
+/*
+Platform.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+#include "Common.h"
+
+#include <fstream>
+#include <sched.h>  // For sched_setaffinity()
+#include <unistd.h>  // For sysconf(), gethostname()
+#include <sys/utsname.h>  // For uname()
+#include <sys/ioctl.h>  // For ioctl()
+#include <sys/syscall.h>  // For the perf_event_open system call
+#include <linux/perf_event.h>  // For the hardware counters
+#include <cstring>
+#include <stdint.h>
+
+#ifndef HLH_CXX_FLAGS  // Normally set by the build system
+#define HLH_CXX_FLAGS "unknown"
+#endif
+
+// Operating system helpers (Linux)
+
+// Returns the number of online processor cores
+uint OnlineCores(){
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (uint)n : 1;
+}
+
+// Pins the calling thread (or process) to one core. Returns false if the core is not available.
+bool PinToCore(uint core){
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// A hardware event counter of the calling thread, e.g. the data TLB misses, read with perf_event_open.
+// The counter is unavailable when the kernel or the processor does not allow it (e.g. in a container), then it counts 0.
+class PerfCounter{
+    int fd;  // The counter's file descriptor, -1 if unavailable
+
+    PerfCounter(const PerfCounter &);  // Not copyable, it owns the descriptor
+    PerfCounter & operator=(const PerfCounter &);
+
+public:
+    // The data TLB load misses
+    static const uint64_t dtlb_load_misses = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    // Constructor, type and config are those of perf_event_attr, the default is the data TLB load misses
+    PerfCounter(uint32_t type = PERF_TYPE_HW_CACHE, uint64_t config = dtlb_load_misses){
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~PerfCounter(){
+        if(fd >= 0)
+            close(fd);
+    }
+
+    // Returns whether the counter counts
+    bool Available() const {
+        return fd >= 0;
+    }
+
+    // Resets the counter and starts counting
+    void Start(){
+        if(fd < 0)
+            return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    // Stops counting and returns the count since Start()
+    uint64_t Stop(){
+        uint64_t count = 0;
+        if(fd < 0)
+            return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(fd, &count, sizeof(count)) != sizeof(count))
+            return 0;
+        return count;
+    }
+};
+
+// Describes the host and the build, for benchmark reports
+struct HostInfo{
+    std::string hostname;  // The host name
+    std::string os;  // The operating system name, release and machine
+    std::string cpu;  // The processor model
+    uint cores;  // The number of online cores
+    std::string compiler;  // The compiler version
+    std::string cxx_flags;  // The build type and compiler flags
+
+    // Returns the information of this host, collected once
+    static const HostInfo & Get(){
+        static HostInfo info;
+        static bool collected = false;
+        if(!collected){
+            char name[256] = "";
+            gethostname(name, sizeof(name)-1);
+            info.hostname = name;
+            struct utsname u;
+            if(uname(&u) == 0)
+                info.os = std::string(u.sysname) + " " + u.release + " " + u.machine;
+            std::ifstream cpuinfo("/proc/cpuinfo");
+            std::string line;
+            while(std::getline(cpuinfo, line)){
+                if(line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos){
+                    info.cpu = line.substr(line.find(':') + 2);
+                    break;
+                }
+            }
+            info.cores = OnlineCores();
+#ifdef __VERSION__
+            info.compiler = __VERSION__;
+#endif
+            info.cxx_flags = HLH_CXX_FLAGS;
+            collected = true;
+        }
+        return info;
+    }
+};
+
+#endif /* PLATFORM_H_ */
@@ -0,0 +1,54 @@
+/*
+Replay.cpp
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Experiment.h"
+#include "CommandLine.h"
+#include "OpLog.h"
+
+// Replays an operation log recorded by an Experiment directly on an algorithm,
+// timing only the algorithm's Append/Expire/QueryHeaviest calls
+int main(int argc, char **argv){
+
+    std::pair<std::pair<std::string,Experiment::AlgorithmType>,uint> result = readReplayParams(argc, argv);  // Get the replay params from the command line
+    std::string log_file = result.first.first;
+    Experiment::AlgorithmType alg_type = result.first.second;
+    uint times = result.second;
+
+    OpLogReader log(log_file);  // Map the log
+    const OpLogHeader & header = log.Header();
+
+    MultiShotTimer timer;  // Create a timer
+    for(uint i = 0; i < times; i++){ // Run multiple replays
+        Algorithm * algorithm = Experiment::CreateAlgorithm(alg_type, header.max_queue_size);  // Create the algorithm
+        timer.Start();  // Start timing
+        log.Replay(algorithm);  // Run the recorded operations
+        timer.Stop();  // Stop timing
+        delete algorithm;
+    }
+
+    // Print replay info plus timing info
+    std::cout << "Replayed: " << log_file << ", Ops:" << header.op_count << ", Chunks:" << header.chunk_count
+        << ", FlowCount:" << header.flow_count << ", QSize:" << header.max_queue_size << ", K:" << header.k_heaviest
+        << ", AlgType:" << Experiment::AlgTypeStr(alg_type) << ", ";
+    std::cout << "Execution Time Statistics: " << timer << std::endl;
+
+    return 0;
+}
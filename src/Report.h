@@ -0,0 +1,268 @@
+/*
+Report.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REPORT_H_
+#define REPORT_H_
+
+#include "Common.h"
+#include "Experiment.h"
+#include "Platform.h"
+
+#include <sstream>
+
+// The result of one repetition of an experiment
+struct ResultRow{
+    Experiment::Params params;  // The parameters the experiment ran with
+    uint repetition;  // The repetition number, from 1
+    double seconds;  // The execution time
+    uint packets;  // The number of packets processed
+    double baseline_seconds;  // The mean NoProcessing execution time with the same parameters (0 if not subtracted)
+    AllocationStats memory;  // The memory usage of the algorithm (all zero unless Params::memory_stats)
+    LatencyRecorder latency;  // The query latencies
+    AccuracyStats accuracy;  // The accuracy of the validated queries (no queries unless Params::validation)
+    uint64_t validation_stalls;  // The number of waits for the validation threads (0 unless Params::validation_threads)
+    uint resizes;  // The number of times the queue was resized (0 unless Params::resize_sizes)
+    double restore_seconds;  // The time taken to restore the checkpoint (0 unless Params::restore_file)
+    double checkpoint_seconds;  // The time taken to save the checkpoint (0 unless Params::checkpoint_file)
+    StageStats generator, queuer, accounter;  // The generator, queue and algorithm stages (no items unless Params::pipeline)
+    LatencyRecorder end_to_end;  // The latencies from the generation of the packets to their Append (none unless Params::pipeline)
+    double tee_total_seconds;  // The time of the whole tee experiment, seconds being the algorithm's share (0 unless Params::tee)
+
+    ResultRow(const Experiment::Params & params, uint repetition=0, double seconds=0.0, uint packets=0, double baseline_seconds=0.0,
+              const AllocationStats & memory=AllocationStats())
+    :params(params), repetition(repetition), seconds(seconds), packets(packets), baseline_seconds(baseline_seconds), memory(memory),
+     validation_stalls(0), resizes(0), restore_seconds(0.0), checkpoint_seconds(0.0), tee_total_seconds(0.0) {}
+};
+
+// Writes experiment results as machine readable rows, one row per repetition.
+// CSV starts with a header line; JSON is written as JSON Lines, one object per line.
+class ResultWriter {
+protected:
+    std::ostream & out;  // The stream rows are written to
+    Experiment::OutputFormat format;  // The output format, CSV or JSON
+
+    std::vector<std::string> names;  // The field names of the row being built
+    std::vector<std::string> values;  // The field values of the row being built
+    std::vector<bool> quoted;  // Whether each value is a string
+
+public:
+    ResultWriter(std::ostream & out, Experiment::OutputFormat format)
+    :out(out), format(format) {}
+
+    // Writes the CSV header line, does nothing for JSON
+    void Header(){
+        if(format != Experiment::CSV)
+            return;
+        BuildRow(ResultRow(Experiment::Params()));
+        for(uint i=0; i<names.size(); ++i)
+            out << (i ? "," : "") << names[i];
+        out << std::endl;
+    }
+
+    // Writes the row of one repetition of an experiment
+    void Row(const ResultRow & row){
+        BuildRow(row);
+        if(format == Experiment::CSV){
+            for(uint i=0; i<values.size(); ++i)
+                out << (i ? "," : "") << (quoted[i] ? CsvQuote(values[i]) : values[i]);
+        }else{
+            out << "{";
+            for(uint i=0; i<values.size(); ++i)
+                out << (i ? ", " : "") << "\"" << names[i] << "\": " << (quoted[i] ? JsonQuote(values[i]) : values[i]);
+            out << "}";
+        }
+        out << std::endl;
+    }
+
+    // Returns the names of the fields that identify a configuration (all the fields except the measurements)
+    static std::vector<std::string> KeyFields(){
+        std::vector<std::string> keys;
+        keys.push_back("alg"); keys.push_back("seq_size"); keys.push_back("flow_count"); keys.push_back("max_queue_size");
+        keys.push_back("k_heaviest"); keys.push_back("random_seed"); keys.push_back("validation"); keys.push_back("trace_file");
+        keys.push_back("memory_stats"); keys.push_back("query_mode"); keys.push_back("query_interval");
+        return keys;
+    }
+
+    // Collects the fields of a row, without writing it
+    void BuildRow(const ResultRow & row){
+        const Experiment::Params & p = row.params;
+        names.clear(); values.clear(); quoted.clear();
+        Add("number", p.number);
+        Add("repetition", row.repetition);
+        AddString("alg", Experiment::AlgTypeStr(p.alg_type));
+        Add("seq_size", p.seq_size);
+        Add("flow_count", p.flow_count);
+        Add("max_queue_size", p.max_queue_size);
+        Add("k_heaviest", p.k_heaviest);
+        Add("phi", p.phi);
+        Add("notify", p.notify);
+        Add("threshold", p.threshold);
+        AddString("query_mode", Experiment::QueryModeStr(p.query_mode));
+        Add("query_interval", p.query_interval);
+        Add("random_seed", p.random_seed);
+        Add("validation", p.validation);
+        Add("validation_threads", p.validation_threads);
+        Add("validation_sample", p.validation_sample);
+        Add("check", p.check);
+        AddString("trace_file", p.trace_file);
+        AddString("oplog_file", p.oplog_file);
+        Add("memory_stats", p.memory_stats);
+        Add("epsilon", p.sketch.epsilon);
+        Add("delta", p.sketch.delta);
+        Add("memory_budget", p.sketch.memory_budget);
+        Add("candidates", p.sketch.candidates);
+        AddList("prefix_lengths", p.prefix_lengths);
+        AddList("resize_sizes", p.resize_sizes);
+        Add("resize_every", p.resize_every);
+        AddString("restore_file", p.restore_file);
+        AddString("checkpoint_file", p.checkpoint_file);
+        AddString("huge_pages", Experiment::PageSizeStr(p.huge_pages));
+        Add("numa_node", p.numa_node);
+        std::vector<std::string> tee;
+        foreach(Experiment::AlgorithmType alg_type, p.tee)
+            tee.push_back(Experiment::AlgTypeStr(alg_type));
+        AddList("tee", tee);
+        Add("tee_slice", p.tee_slice);
+        Add("pipeline", p.pipeline);
+        Add("pipeline_batch", p.pipeline_batch);
+        AddList("pipeline_cores", p.pipeline_cores);
+
+        // Measurements and rates derived from them, net of the packet generation and queueing overhead
+        double net_seconds = row.seconds - row.baseline_seconds;
+        Add("seconds", row.seconds);
+        Add("packets", row.packets);
+        Add("baseline_seconds", row.baseline_seconds);
+        Add("net_seconds", net_seconds);
+        Add("packets_per_sec", (net_seconds > 0) ? row.packets / net_seconds : 0.0);
+        Add("ns_per_packet", (row.packets > 0) ? net_seconds * 1e9 / row.packets : 0.0);
+        Add("peak_bytes", row.memory.peak_bytes);
+        Add("live_bytes", row.memory.live_bytes);
+        Add("allocations", row.memory.allocations - row.memory.setup_allocations);
+        Add("allocs_per_op", row.memory.AllocationsPerOp());
+        Add("queries", row.latency.Count());
+        Add("query_mean_ns", row.latency.Mean());
+        Add("query_p50_ns", row.latency.Quantile(0.5));
+        Add("query_p99_ns", row.latency.Quantile(0.99));
+        Add("query_max_ns", row.latency.Max());
+        Add("validation_stalls", row.validation_stalls);
+        Add("resizes", row.resizes);
+        Add("restore_seconds", row.restore_seconds);
+        Add("checkpoint_seconds", row.checkpoint_seconds);
+        Add("tee_total_seconds", row.tee_total_seconds);
+        AddStage("generator", row.generator);
+        AddStage("queue", row.queuer);
+        AddStage("algorithm", row.accounter);
+        Add("end_to_end_mean_ns", row.end_to_end.Mean());
+        Add("end_to_end_p50_ns", row.end_to_end.Quantile(0.5));
+        Add("end_to_end_p99_ns", row.end_to_end.Quantile(0.99));
+        Add("end_to_end_max_ns", row.end_to_end.Max());
+        Add("accuracy_queries", row.accuracy.queries);
+        if(row.accuracy.queries > 0){
+            Add("precision", row.accuracy.Precision());
+            Add("recall", row.accuracy.Recall());
+            Add("mean_count_error", row.accuracy.MeanCountError());
+            Add("max_count_error", row.accuracy.max_count_error);
+        }else{  // Not measured, rather than a perfect score
+            AddNull("precision");
+            AddNull("recall");
+            AddNull("mean_count_error");
+            AddNull("max_count_error");
+        }
+
+        const HostInfo & host = HostInfo::Get();
+        AddString("host", host.hostname);
+        AddString("os", host.os);
+        AddString("cpu", host.cpu);
+        Add("cores", host.cores);
+        AddString("compiler", host.compiler);
+        AddString("cxx_flags", host.cxx_flags);
+    }
+
+    // The field names and (unquoted) values collected by BuildRow()
+    const std::vector<std::string> & Names() const { return names; }
+    const std::vector<std::string> & Values() const { return values; }
+
+protected:
+    template <class T>
+    void Add(const char * name, const T & value){
+        std::ostringstream s;
+        s.precision(9);
+        s << value;
+        names.push_back(name);
+        values.push_back(s.str());
+        quoted.push_back(false);
+    }
+
+    void AddString(const char * name, const std::string & value){
+        names.push_back(name);
+        values.push_back(value);
+        quoted.push_back(true);
+    }
+
+    // Adds the throughput and the waits of a pipeline stage, as <stage>_items_per_sec, <stage>_stalls and <stage>_starves
+    void AddStage(const std::string & stage, const StageStats & stats){
+        Add((stage + "_items_per_sec").c_str(), stats.ItemsPerSecond());
+        Add((stage + "_stalls").c_str(), stats.stalls);
+        Add((stage + "_starves").c_str(), stats.starves);
+    }
+
+    // Adds a list as a string of comma separated values, as given on the command line
+    template <class T>
+    void AddList(const char * name, const std::vector<T> & list){
+        std::ostringstream s;
+        for(uint i=0; i<list.size(); ++i)
+            s << (i ? "," : "") << list[i];
+        AddString(name, s.str());
+    }
+
+    // Adds a field without a value: empty in CSV, null in JSON
+    void AddNull(const char * name){
+        names.push_back(name);
+        values.push_back((format == Experiment::JSON) ? "null" : "");
+        quoted.push_back(false);
+    }
+
+    // Quotes a CSV field if it contains separators or quotes
+    static std::string CsvQuote(const std::string & s){
+        if(s.find_first_of(",\"\r\n") == std::string::npos)
+            return s;
+        std::string q = "\"";
+        foreach(char c, s){
+            if(c == '"') q += '"';
+            q += c;
+        }
+        return q + "\"";
+    }
+
+    // Quotes and escapes a JSON string
+    static std::string JsonQuote(const std::string & s){
+        std::string q = "\"";
+        foreach(char c, s){
+            if(c == '"' || c == '\\'){ q += '\\'; q += c; }
+            else if(c == '\n') q += "\\n";
+            else if((unsigned char)c < 0x20) q += ' ';
+            else q += c;
+        }
+        return q + "\"";
+    }
+};
+
+#endif /* REPORT_H_ */
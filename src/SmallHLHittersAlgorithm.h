@@ -0,0 +1,330 @@
+/*
+SmallHLHittersAlgorithm.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SMALLHLHITTERSALGORITHM_H_
+#define SMALLHLHITTERSALGORITHM_H_
+
+#include "Common.h"
+#include "Algorithm.h"
+
+#include <stdint.h>
+
+// The bitmap of Q bits used by SmallHLHittersAlgorithm<Q>, and log2(Q)
+template <uint Q> struct SmallBitmap;
+template <> struct SmallBitmap<8>  { typedef uint8_t type;  static const uint log2 = 3; };
+template <> struct SmallBitmap<16> { typedef uint16_t type; static const uint log2 = 4; };
+template <> struct SmallBitmap<32> { typedef uint32_t type; static const uint log2 = 5; };
+template <> struct SmallBitmap<64> { typedef uint64_t type; static const uint log2 = 6; };
+
+
+// HL-Hitters specialized at compile time for queues of at most Q packets, Q being 8, 16, 32 or 64.
+// With so few packets there are at most Q flows and Q counts, so the count list and the SCRs become bitmaps held inside
+// the object: a flow occupies one of Q slots, each count has the bitmap of the slots with that count (its SCR), and a
+// bitmap of the non-empty counts replaces the links between the SCRs. The heaviest and lightest counts are its highest
+// and lowest set bits, found with a single instruction, and moving a flow to the next count flips two bits.
+// The flows are found through an open addressing hash table of 2Q slot numbers, so the whole structure is a few
+// cache lines and an update never allocates or follows a pointer into the heap.
+template <uint Q>
+class SmallHLHittersAlgorithm : public Algorithm {
+protected:
+    typedef typename SmallBitmap<Q>::type Bitmap;
+
+    static const uint table_size = 2 * Q;  // The hash table is at most half full
+    static const uint table_bits = SmallBitmap<Q>::log2 + 1;
+    static const uint8_t no_slot = 0xFF;
+
+    uint max_queue_size;  // The maximum number of elements allowed in the queue, at most Q, see Resize()
+    uint total_count;  // The sum of the counts of the flows
+
+    Bitmap free_slots;  // The slots without a flow
+    Bitmap counts;  // The non-empty counts, bit c-1 for count c
+    Bitmap ranges[Q];  // The slots of the flows of each count, ranges[c-1] for count c
+    FlowP slot_flows[Q];  // The flow of each slot
+    uint8_t slot_counts[Q];  // The count of each slot's flow
+    uint8_t table[table_size];  // The slot + 1 of the flows, 0 for an empty entry
+
+    AllocationStats memory;  // The object itself when tracking is enabled, there are no allocations
+    bool track_memory;  // Whether the size and the operations are recorded
+
+public:
+    // Constructor, max_queue_size must be at most Q. track_memory enables recording the size of the structure.
+    SmallHLHittersAlgorithm(uint max_queue_size, bool track_memory = false)
+    :max_queue_size(max_queue_size), track_memory(track_memory)
+    {
+        Clear();
+        if(track_memory)
+            memory.live_bytes = memory.peak_bytes = sizeof(*this);
+        memory.EndSetup();
+    }
+
+    // Returns the size of the structure, which lives inside the object
+    virtual AllocationStats MemoryStats(){
+        return memory;
+    }
+
+    // Executed when a new item is received
+    virtual void Append(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count++;
+        FlowP flowp = packet.flowp;
+        uint slot = Find(flowp);
+        if(slot == no_slot){  // A new flow takes the lowest free slot
+            if(free_slots == 0){
+                std::cout << "Error: More than " << Q << " flows appended to Small-HL-Hitters" << std::endl;
+                ::exit(-1);
+            }
+            slot = Lowest(free_slots);
+            free_slots &= ~Bit(slot);
+            slot_flows[slot] = flowp;
+            slot_counts[slot] = 0;
+            Insert(slot);
+        }else
+            Leave(slot);
+        slot_counts[slot]++;
+        Join(slot);
+    }
+
+    // Executed when an item is served
+    virtual void Expire(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count--;
+        uint slot = Find(packet.flowp);
+        Leave(slot);
+        if(--slot_counts[slot] == 0){  // The flow is discarded
+            Erase(slot);
+            free_slots |= Bit(slot);
+        }else
+            Join(slot);
+    }
+
+    // Calculates and returns the k Heaviest Hitters in the provided result container
+    virtual void QueryHeaviest(uint k, HittersQueryResult & result){
+        uint n = 0;
+        for(uint64_t c = counts; c != 0 && n < k; c &= ~((uint64_t)1 << Highest(c))){
+            uint count = Highest(c) + 1;
+            for(uint64_t s = ranges[count-1]; s != 0 && n < k; s &= s - 1, ++n)
+                result.push_back(FlowCountPair(slot_flows[Lowest(s)], count));
+        }
+    }
+
+    // Writes the flows with a count of at least c, heaviest first, into result (at most max_results) and returns their number
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results){
+        uint n = 0;
+        for(uint64_t b = counts; b != 0 && n < max_results && Highest(b) + 1 >= c; b &= ~((uint64_t)1 << Highest(b))){
+            uint count = Highest(b) + 1;
+            for(uint64_t s = ranges[count-1]; s != 0 && n < max_results; s &= s - 1, ++n)
+                result[n] = FlowCountPair(slot_flows[Lowest(s)], count);
+        }
+        return n;
+    }
+
+    // Returns the number of packets currently counted
+    virtual uint TotalCount(){
+        return total_count;
+    }
+
+    // Returns the count of a flow, 0 if it is not counted
+    virtual uint GetCount(FlowP flowp){
+        uint slot = Find(flowp);
+        return (slot != no_slot) ? slot_counts[slot] : 0;
+    }
+
+    // Returns 1 + the number of flows with a greater count than flowp, 0 if it is not counted
+    virtual uint Rank(FlowP flowp){
+        uint slot = Find(flowp);
+        if(slot == no_slot)
+            return 0;
+        uint rank = 1;
+        for(uint64_t c = ((uint64_t)counts >> (slot_counts[slot] - 1)) >> 1; c != 0; c &= c - 1)  // The counts above the flow's
+            rank += Population(ranges[slot_counts[slot] + Lowest(c)]);
+        return rank;
+    }
+
+    // Returns the number of flows at each count in the provided result container
+    virtual void QueryHistogram(FlowSizeHistogram & result){
+        for(uint64_t c = counts; c != 0; c &= c - 1)
+            result.push_back(CountFlowsPair(Lowest(c) + 1, Population(ranges[Lowest(c)])));
+    }
+
+    // Returns the number of distinct counts among the flows
+    virtual uint DistinctCounts(){
+        return Population(counts);
+    }
+
+    // Returns the count of the flow at position ceil(q*flows) in increasing count order, 0 if no flows are counted
+    virtual uint FlowSizeQuantile(double q){
+        uint flow_count = Population((Bitmap)~free_slots);
+        if(flow_count == 0)
+            return 0;
+        uint pos = QuantilePosition(q, flow_count);
+        uint flows = 0;
+        for(uint64_t c = counts; ; c &= c - 1){
+            flows += Population(ranges[Lowest(c)]);
+            if(flows >= pos)
+                return Lowest(c) + 1;
+        }
+    }
+
+    // Returns the Shannon entropy in bits of the distribution of the counted packets over the flows
+    virtual double FlowSizeEntropy(){
+        double entropy = 0.0;
+        for(uint64_t c = counts; c != 0; c &= c - 1)
+            entropy += EntropyTerm(Lowest(c) + 1, Population(ranges[Lowest(c)]), total_count);
+        return entropy;
+    }
+
+    // Rebuilds the structure from n flows on an empty algorithm, in O(n)
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        if(total_count != 0)
+            return false;
+        for(uint i=0; i<n; ++i){
+            uint count = flows[i].second;
+            if(count == 0 || count > max_queue_size || free_slots == 0 || Find(flows[i].first) != no_slot)
+                return false;
+            uint slot = Lowest(free_slots);
+            free_slots &= ~Bit(slot);
+            slot_flows[slot] = flows[i].first;
+            slot_counts[slot] = count;
+            Insert(slot);
+            Join(slot);
+            total_count += count;
+        }
+        return total_count <= max_queue_size;
+    }
+
+    // Changes the maximum queue size, which cannot exceed the compile time capacity Q
+    virtual bool Resize(uint new_max_queue_size){
+        if(new_max_queue_size > Q || total_count > new_max_queue_size)
+            return false;
+        max_queue_size = new_max_queue_size;
+        return true;
+    }
+
+    // Empties the structure, in O(Q) which is constant for the specialization
+    virtual bool Reset(){
+        Clear();
+        memory.Restart();
+        return true;
+    }
+
+protected:
+    // Empties every bitmap and the hash table
+    void Clear(){
+        total_count = 0;
+        free_slots = (Bitmap)~(Bitmap)0;
+        counts = 0;
+        for(uint i=0; i<Q; ++i)
+            ranges[i] = 0;
+        for(uint i=0; i<table_size; ++i)
+            table[i] = 0;
+    }
+
+    // Adds a slot to the SCR of its count
+    void Join(uint slot){
+        uint c = slot_counts[slot] - 1;
+        ranges[c] |= Bit(slot);
+        counts |= Bit(c);
+    }
+
+    // Removes a slot from the SCR of its count
+    void Leave(uint slot){
+        uint c = slot_counts[slot] - 1;
+        ranges[c] &= ~Bit(slot);
+        if(ranges[c] == 0)
+            counts &= ~Bit(c);
+    }
+
+    // Returns the hash table entry a flow starts probing from
+    static uint Home(FlowP flowp){
+        return (uint)(((uint64_t)(uintptr_t)flowp * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits));
+    }
+
+    // Returns the slot of a flow, no_slot if it is not counted
+    uint Find(FlowP flowp) const {
+        for(uint i = Home(flowp); table[i] != 0; i = (i + 1) & (table_size - 1))
+            if(slot_flows[table[i] - 1] == flowp)
+                return table[i] - 1;
+        return no_slot;
+    }
+
+    // Adds the flow of a slot to the hash table
+    void Insert(uint slot){
+        uint i = Home(slot_flows[slot]);
+        while(table[i] != 0)
+            i = (i + 1) & (table_size - 1);
+        table[i] = slot + 1;
+    }
+
+    // Removes the flow of a slot from the hash table, shifting back the entries after it so that no probe stops early
+    void Erase(uint slot){
+        uint i = Home(slot_flows[slot]);
+        while(table[i] != slot + 1)
+            i = (i + 1) & (table_size - 1);
+        for(uint j = (i + 1) & (table_size - 1); table[j] != 0; j = (j + 1) & (table_size - 1)){
+            uint home = Home(slot_flows[table[j] - 1]);
+            if(((j - home) & (table_size - 1)) >= ((j - i) & (table_size - 1))){  // The entry may move back to i
+                table[i] = table[j];
+                i = j;
+            }
+        }
+        table[i] = 0;
+    }
+
+    static Bitmap Bit(uint i){
+        return (Bitmap)((uint64_t)1 << i);
+    }
+
+    // Returns the index of the lowest set bit of a non-zero bitmap
+    static uint Lowest(uint64_t b){
+        return __builtin_ctzll(b);
+    }
+
+    // Returns the index of the highest set bit of a non-zero bitmap
+    static uint Highest(uint64_t b){
+        return 63 - __builtin_clzll(b);
+    }
+
+    // Returns the number of set bits of a bitmap
+    static uint Population(uint64_t b){
+        return __builtin_popcountll(b);
+    }
+};
+
+
+// Returns the capacity of the SmallHLHittersAlgorithm specialization for a queue size, 0 if it is too large for any
+uint SmallHLHittersCapacity(uint max_queue_size){
+    return (max_queue_size <= 8) ? 8 : (max_queue_size <= 16) ? 16 : (max_queue_size <= 32) ? 32 : (max_queue_size <= 64) ? 64 : 0;
+}
+
+// Creates the smallest SmallHLHittersAlgorithm specialization for a queue size, NULL if it is too large for any
+Algorithm * CreateSmallHLHitters(uint max_queue_size, bool track_memory = false){
+    switch (SmallHLHittersCapacity(max_queue_size)){
+    case 8: return new SmallHLHittersAlgorithm<8>(max_queue_size, track_memory);
+    case 16: return new SmallHLHittersAlgorithm<16>(max_queue_size, track_memory);
+    case 32: return new SmallHLHittersAlgorithm<32>(max_queue_size, track_memory);
+    case 64: return new SmallHLHittersAlgorithm<64>(max_queue_size, track_memory);
+    default: return NULL;
+    }
+}
+
+#endif /* SMALLHLHITTERSALGORITHM_H_ */
@@ -0,0 +1,57 @@
+/*
+SmallQueues.cpp
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Experiment.h"
+#include "TeeExperiment.h"
+
+// Compares HL-Hitters with its compile time specializations for small queues, on the small queue sizes of the Fig. 2 sweep
+// and the capacities of the specializations. Each queue size feeds the same generated packets to both.
+int main(int argc, char **argv){
+    using namespace boost::assign;
+    Experiment::Params p;
+
+    // Set the constant parameters
+    p.seq_size = 1000000;
+    p.flow_count =  150;
+    p.k_heaviest = 1;
+    p.random_seed = 1;
+    p.validation = false;
+
+    uint times = 10;  // Run each experiment 10 times
+
+
+    p.number = 0;
+
+    std::vector<uint> max_queue_sizes;  // The queue sizes simulated
+    max_queue_sizes += 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 16, 20, 30, 32, 40, 50, 64;
+
+    std::vector<Experiment::AlgorithmType> alg_types;  // The algorithms simulated
+    alg_types += Experiment::NOPROCESSING, Experiment::HLHITTERS, Experiment::SMALLHLHITTERS;
+
+    p.tee = alg_types;
+    foreach(uint max_queue_size, max_queue_sizes){
+        p.max_queue_size = max_queue_size;
+        p.number ++;
+        TeeExperiment::RunTee(p, times);
+    }
+
+    return 0;
+}
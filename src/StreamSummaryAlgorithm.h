@@ -0,0 +1,251 @@
+/*
+StreamSummaryAlgorithm.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STREAMSUMMARYALGORITHM_H_
+#define STREAMSUMMARYALGORITHM_H_
+
+#include "Common.h"
+#include "Algorithm.h"
+
+// Heaviest Hitters algorithm using the Stream-Summary structure of Space-Saving (Metwally et al.), adapted to decrements.
+// The flows are grouped into buckets of the same count, in a list of buckets sorted on the counts, and a flow moves to the
+// neighbouring bucket on Append and Expire in O(1). A counter is kept for every flow in the queue, so unlike Space-Saving
+// no flow is ever evicted and the counts are exact.
+class StreamSummaryAlgorithm : public Algorithm {
+protected:
+    typedef std::list<FlowP, TrackingAllocator<FlowP> > FlowList;  // The flows of a bucket
+    typedef FlowList::iterator FlowListIt;
+
+    // The flows with the same count
+    struct Bucket{
+        uint count;
+        FlowList flows;
+
+        Bucket(uint count, const FlowList::allocator_type & alloc)
+        :count(count), flows(alloc) {}
+    };
+    typedef std::list<Bucket, TrackingAllocator<Bucket> > BucketList;  // The buckets, lightest first
+    typedef BucketList::iterator BucketListIt;
+    typedef BucketList::reverse_iterator BucketListItR;
+
+    // Where a flow is counted
+    struct Counter{
+        BucketListIt bucket;  // The bucket of its count
+        FlowListIt node;  // Its node in the bucket
+    };
+    typedef std::pair<const FlowP, Counter> CounterMapPair;
+    typedef boost::unordered_map<FlowP, Counter, boost::hash<FlowP>, std::equal_to<FlowP>,
+                                 TrackingAllocator<CounterMapPair> > CounterMap;
+
+    AllocationStats memory;  // The memory usage of the buckets and the counters, recorded when tracking is enabled
+    bool track_memory;  // Whether the memory usage and the operations are recorded
+    FlowList::allocator_type flow_alloc;  // The allocator of the buckets' flow lists
+    BucketList buckets;  // The buckets
+    CounterMap counters;  // The counter of each flow
+    uint total_count;  // The sum of the counts
+
+public:
+    // Constructor, track_memory enables recording the memory usage of the buckets and the counters
+    StreamSummaryAlgorithm(bool track_memory = false)
+    :track_memory(track_memory), flow_alloc(track_memory ? &memory : NULL),
+     buckets(BucketList::allocator_type(track_memory ? &memory : NULL)),
+     counters(CounterMap::allocator_type(track_memory ? &memory : NULL)),
+     total_count(0)
+    {
+        memory.EndSetup();
+    }
+
+    // Executed when a new item is received
+    virtual void Append(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count++;
+        FlowP flowp = packet.flowp;
+        CounterMap::iterator it = counters.find(flowp);
+        if(it == counters.end()){  // A new flow goes into the bucket of count 1, at the front
+            BucketListIt first = buckets.begin();
+            if(first == buckets.end() || first->count != 1)
+                first = buckets.insert(first, Bucket(1, flow_alloc));
+            Counter c;
+            c.bucket = first;
+            c.node = first->flows.insert(first->flows.end(), flowp);
+            counters.insert(CounterMapPair(flowp, c));
+            return;
+        }
+        Counter & c = it->second;
+        BucketListIt next = c.bucket;
+        ++next;
+        if(next == buckets.end() || next->count != c.bucket->count + 1)
+            next = buckets.insert(next, Bucket(c.bucket->count + 1, flow_alloc));
+        MoveTo(c, next);
+    }
+
+    // Executed when an item is served
+    virtual void Expire(Packet & packet){
+        if(track_memory)
+            memory.operations++;
+        total_count--;
+        CounterMap::iterator it = counters.find(packet.flowp);
+        Counter & c = it->second;
+        if(c.bucket->count == 1){  // The flow's last packet
+            c.bucket->flows.erase(c.node);
+            if(c.bucket->flows.empty())
+                buckets.erase(c.bucket);
+            counters.erase(it);
+            return;
+        }
+        BucketListIt prev = c.bucket;
+        if(prev == buckets.begin() || (--prev)->count != c.bucket->count - 1)
+            prev = buckets.insert(c.bucket, Bucket(c.bucket->count - 1, flow_alloc));
+        MoveTo(c, prev);
+    }
+
+    // Returns the memory usage of the buckets and the counters
+    virtual AllocationStats MemoryStats(){
+        return memory;
+    }
+
+    // Calculates and returns the k Heaviest Hitters in the provided result container, walking down from the heaviest bucket
+    virtual void QueryHeaviest(uint k, HittersQueryResult & result){
+        uint n = 0;
+        for(BucketListItR b = buckets.rbegin(); b != buckets.rend() && n < k; ++b)
+            for(FlowListIt f = b->flows.begin(); f != b->flows.end() && n < k; ++f, ++n)
+                result.push_back(FlowCountPair(*f, b->count));
+    }
+
+    // Writes the flows with a count of at least c, heaviest first, into result (at most max_results) and returns their number
+    virtual uint QueryAboveCount(uint c, FlowCountPair * result, uint max_results){
+        uint n = 0;
+        for(BucketListItR b = buckets.rbegin(); b != buckets.rend() && b->count >= c && n < max_results; ++b)
+            for(FlowListIt f = b->flows.begin(); f != b->flows.end() && n < max_results; ++f)
+                result[n++] = FlowCountPair(*f, b->count);
+        return n;
+    }
+
+    // Returns the number of packets currently counted
+    virtual uint TotalCount(){
+        return total_count;
+    }
+
+    // Returns the count of a flow, 0 if it is not counted
+    virtual uint GetCount(FlowP flowp){
+        CounterMap::iterator it = counters.find(flowp);
+        return (it != counters.end()) ? it->second.bucket->count : 0;
+    }
+
+    // Returns 1 + the number of flows with a greater count than flowp, 0 if it is not counted. O(distinct heavier counts).
+    virtual uint Rank(FlowP flowp){
+        CounterMap::iterator it = counters.find(flowp);
+        if(it == counters.end())
+            return 0;
+        uint rank = 1;
+        BucketListIt b = it->second.bucket;
+        for(++b; b != buckets.end(); ++b)
+            rank += b->flows.size();
+        return rank;
+    }
+
+    // Returns true if fewer than k flows have a greater count than flowp, stopping once k heavier flows are found
+    virtual bool IsInTopK(FlowP flowp, uint k){
+        CounterMap::iterator it = counters.find(flowp);
+        if(it == counters.end() || k == 0)
+            return false;
+        uint heavier = 0;
+        BucketListIt b = it->second.bucket;
+        for(++b; b != buckets.end(); ++b)
+            if((heavier += b->flows.size()) >= k)
+                return false;
+        return true;
+    }
+
+    // The flow size distribution queries walk the buckets from the lightest, so they are O(distinct counts)
+
+    // Returns the number of flows at each count in the provided result container
+    virtual void QueryHistogram(FlowSizeHistogram & result){
+        foreach(Bucket & b, buckets)
+            result.push_back(CountFlowsPair(b.count, b.flows.size()));
+    }
+
+    // Returns the number of distinct counts among the flows. O(1).
+    virtual uint DistinctCounts(){
+        return buckets.size();
+    }
+
+    // Returns the count of the flow at position ceil(q*flows) in increasing count order, 0 if no flows are counted
+    virtual uint FlowSizeQuantile(double q){
+        if(buckets.empty())
+            return 0;
+        uint pos = QuantilePosition(q, counters.size());
+        uint flows = 0;
+        foreach(Bucket & b, buckets)
+            if((flows += b.flows.size()) >= pos)
+                return b.count;
+        return buckets.back().count;
+    }
+
+    // Returns the Shannon entropy in bits of the distribution of the counted packets over the flows
+    virtual double FlowSizeEntropy(){
+        double entropy = 0.0;
+        foreach(Bucket & b, buckets)
+            entropy += EntropyTerm(b.count, b.flows.size(), total_count);
+        return entropy;
+    }
+
+    // Empties the buckets and the counters, keeping the counter map's buckets: O(flows)
+    virtual bool Reset(){
+        buckets.clear();
+        counters.clear();
+        total_count = 0;
+        memory.Restart();
+        return true;
+    }
+
+    // Rebuilds the buckets from n flows, heaviest first, on an empty algorithm. Appends them lightest first: O(n).
+    virtual bool Restore(const FlowCountPair * flows, uint n){
+        if(!counters.empty())
+            return false;
+        for(uint i=n; i-- > 0;){
+            uint count = flows[i].second;
+            if(count == 0 || (!buckets.empty() && count < buckets.back().count) || counters.count(flows[i].first))
+                return false;
+            if(buckets.empty() || buckets.back().count != count)
+                buckets.push_back(Bucket(count, flow_alloc));
+            Counter c;
+            c.bucket = --buckets.end();
+            c.node = c.bucket->flows.insert(c.bucket->flows.end(), flows[i].first);
+            counters.insert(CounterMapPair(flows[i].first, c));
+            total_count += count;
+        }
+        return true;
+    }
+
+protected:
+    // Moves a counted flow into another bucket, splicing its node so nothing is allocated, and drops its old bucket if it empties
+    void MoveTo(Counter & c, BucketListIt to){
+        BucketListIt from = c.bucket;
+        to->flows.splice(to->flows.end(), from->flows, c.node);
+        c.bucket = to;
+        if(from->flows.empty())
+            buckets.erase(from);
+    }
+};
+
+#endif /* STREAMSUMMARYALGORITHM_H_ */
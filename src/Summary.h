@@ -0,0 +1,165 @@
+/*
+Summary.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SUMMARY_H_
+#define SUMMARY_H_
+
+#include "Common.h"
+#include "Network.h"
+#include "Algorithm.h"
+
+#include <cstring>
+#include <stdint.h>
+
+// A summary is the complete state of an algorithm on one node: every counted flow with its count, heaviest first.
+// Summaries of several nodes merge into the exact global counts over the union of their windows.
+//
+// Layout (all integers little endian):
+//   Header  : SummaryHeader (32 bytes)
+//   Entries : entry_count x SummaryEntry (8 bytes), in decreasing count order
+struct SummaryHeader{
+    char magic[8];  // "HLHSUMRY"
+    uint32_t version;  // The format version, currently 1
+    uint32_t node;  // The node which produced the summary
+    uint32_t entry_count;  // The number of entries
+    uint32_t total_count;  // The sum of the counts
+    char reserved[8];
+};
+
+// A flow and its count in a summary. A generated flow has the same id on every node, but the flows of a replayed trace
+// are numbered in the order one process discovers them, so the summaries of a trace are only meaningful to that process.
+struct SummaryEntry{
+    uint32_t flow_id;  // The flow key
+    uint32_t count;  // The flow's count
+};
+
+// Serializes the state of an algorithm into buffer, replacing its contents
+void SerializeSummary(Algorithm & algorithm, uint node, std::vector<char> & buffer){
+    std::vector<FlowCountPair> flows(algorithm.TotalCount());  // There are at most as many flows as counted packets
+    uint n = flows.empty() ? 0 : algorithm.QueryAboveCount(1, &flows[0], flows.size());
+
+    buffer.resize(sizeof(SummaryHeader) + n * sizeof(SummaryEntry));
+    SummaryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "HLHSUMRY", 8);
+    header.version = 1;
+    header.node = node;
+    header.entry_count = n;
+    header.total_count = algorithm.TotalCount();
+    std::memcpy(&buffer[0], &header, sizeof(header));
+
+    SummaryEntry * entries = (SummaryEntry *)(&buffer[0] + sizeof(SummaryHeader));
+    for(uint i=0; i<n; ++i){
+        entries[i].flow_id = flows[i].first->id;
+        entries[i].count = flows[i].second;
+    }
+}
+
+
+// Reads a serialized summary in place, without copying it
+class SummaryView {
+    const SummaryHeader * header;  // The header, in the buffer
+    const SummaryEntry * entries;  // The entries, in the buffer
+
+public:
+    // Constructor, checks the summary in the size bytes at data. Valid() tells whether it is well formed.
+    SummaryView(const char * data, std::size_t size)
+    :header(NULL), entries(NULL)
+    {
+        if(size < sizeof(SummaryHeader))
+            return;
+        const SummaryHeader * h = (const SummaryHeader *)data;
+        if(std::memcmp(h->magic, "HLHSUMRY", 8) != 0 || h->version != 1
+           || (size - sizeof(SummaryHeader)) / sizeof(SummaryEntry) < h->entry_count)
+            return;
+        header = h;
+        entries = (const SummaryEntry *)(data + sizeof(SummaryHeader));
+    }
+
+    // Returns true if the summary is well formed
+    bool Valid() const { return header != NULL; }
+
+    uint Node() const { return header->node; }
+    uint Size() const { return header->entry_count; }
+    uint TotalCount() const { return header->total_count; }
+
+    // The entries, heaviest first
+    typedef const SummaryEntry * const_iterator;
+    typedef const_iterator iterator;
+    const SummaryEntry * begin() const { return entries; }
+    const SummaryEntry * end() const { return entries + header->entry_count; }
+    const SummaryEntry & operator[](uint i) const { return entries[i]; }
+};
+
+
+// Merges the summaries of several nodes into exact global counts
+class SummaryAggregator {
+public:
+    typedef std::pair<uint32_t, uint64_t> FlowTotal;  // A flow id and its global count
+    typedef boost::unordered_map<uint32_t, uint64_t> FlowTotalMap;
+
+protected:
+    FlowTotalMap totals;  // The global count of each flow
+    uint64_t total_count;  // The sum of the global counts
+    uint summaries;  // The number of merged summaries
+
+    // A vector of flow totals used in QueryHeaviest as a intermediate sorting container.
+    // Kept at class level to amortize initialization/allocation costs
+    std::vector<FlowTotal> sorted;
+
+    // Returns true if p>q, used in sorting
+    static bool IsBigger(const FlowTotal & p, const FlowTotal & q){
+        return p.second > q.second || (p.second == q.second && p.first < q.first);
+    }
+
+public:
+    SummaryAggregator()
+    :total_count(0), summaries(0) {}
+
+    // Forgets all merged summaries, keeping the allocated memory
+    void Clear(){
+        totals.clear();
+        total_count = 0;
+        summaries = 0;
+    }
+
+    // Adds the counts of a summary to the global counts. The summaries must be of generated flows, whose ids are global.
+    void Merge(const SummaryView & summary){
+        foreach(const SummaryEntry & e, summary)
+            totals[e.flow_id] += e.count;
+        total_count += summary.TotalCount();
+        summaries++;
+    }
+
+    // Returns the k globally heaviest flows in result, heaviest first (ties by increasing flow id)
+    void QueryHeaviest(uint k, std::vector<FlowTotal> & result){
+        sorted.assign(totals.begin(), totals.end());
+        uint n = std::min((uint)sorted.size(), k);
+        std::partial_sort(sorted.begin(), sorted.begin() + n, sorted.end(), IsBigger);
+        result.assign(sorted.begin(), sorted.begin() + n);
+    }
+
+    uint FlowCount() const { return totals.size(); }
+    uint64_t TotalCount() const { return total_count; }
+    uint Summaries() const { return summaries; }
+};
+
+#endif /* SUMMARY_H_ */
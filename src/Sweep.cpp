@@ -0,0 +1,36 @@
+/*
+Sweep.cpp
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Experiment.h"
+#include "CommandLine.h"
+#include "Sweep.h"
+
+// Runs every combination of a parameter grid in parallel, one experiment process per core.
+// For example, MUE2011_Paper_Fig3 corresponds to:
+//   HL-Hitters-Sweep -a hlhitters -s 1000000 -f 100,1000,10000:100000:10000 -q 10:50:10,100:500:50 -n 10
+int main(int argc, char **argv){
+
+    SweepParams sp = readSweepParams(argc, argv);  // Get the sweep params from the command line and configuration file
+    SweepRunner runner(sp);
+    uint failed = runner.Run();  // Run the sweep
+
+    return (failed == 0) ? 0 : 1;
+}
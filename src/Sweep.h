@@ -0,0 +1,446 @@
+/*
+Sweep.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include "Common.h"
+#include "Experiment.h"
+#include "Report.h"
+#include "Platform.h"
+
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>  // For poll()
+#include <unistd.h>  // For fork(), pipe()
+#include <sys/wait.h>  // For waitpid()
+#include <sys/prctl.h>  // For prctl()
+
+// The parameter grid of a sweep and how to run it
+struct SweepParams{
+    std::vector<Experiment::AlgorithmType> alg_types;  // The algorithms simulated
+    std::vector<uint> seq_sizes;  // The sequence sizes simulated
+    std::vector<uint> flow_counts;  // The flow counts simulated
+    std::vector<uint> max_queue_sizes;  // The queue sizes simulated
+    std::vector<uint> k_heaviests;  // The numbers of heaviest hitters simulated
+    std::vector<uint> random_seeds;  // The random seeds simulated
+    bool validation;  // Whether to validate every configuration
+    bool memory_stats;  // Whether to record the memory usage of the algorithms
+    Experiment::QueryMode query_mode;  // When to run the heaviest hitter queries
+    uint query_interval;  // The number of packets or microseconds between queries
+    std::string trace_file;  // A trace to replay in every configuration (empty for none)
+    uint times;  // The number of repetitions of each configuration
+
+    std::vector<uint> cores;  // The cores to run experiments on, one experiment per core at a time
+    std::string output_file;  // The file rows are written to
+    Experiment::OutputFormat format;  // The format of the rows, CSV or JSON
+    bool resume;  // Whether to keep the rows already in output_file and run only the missing repetitions
+};
+
+// Parses a list of unsigned integers, given as comma separated values and/or from:to[:step] ranges, e.g. "1:10,20:50:10"
+std::vector<uint> ParseUintList(const std::string & text){
+    std::vector<uint> list;
+    std::stringstream items(text);
+    std::string item;
+    while(std::getline(items, item, ',')){
+        uint from, to, step = 1;
+        char c1, c2;
+        std::stringstream s(item);
+        if(!(s >> from)){
+            if(item.find_first_not_of(" \t") == std::string::npos) continue;  // Empty item
+            throw std::invalid_argument("bad integer list item '" + item + "'");
+        }
+        if(s >> c1){
+            if(c1 != ':' || !(s >> to) || to < from || ((s >> c2) && (c2 != ':' || !(s >> step) || step == 0)))
+                throw std::invalid_argument("bad integer range '" + item + "'");
+            for(uint v = from; ; v += step){
+                list.push_back(v);
+                if(to - v < step)  // The next value would pass to, or wrap around
+                    break;
+            }
+        }else
+            list.push_back(from);
+    }
+    return list;
+}
+
+// Reads a sweep configuration file of "name = value" lines ('#' starts a comment).
+// The names are the long command line option names of HL-Hitters-Sweep.
+std::map<std::string,std::string> ReadSweepConfig(const std::string & filename){
+    std::map<std::string,std::string> config;
+    std::ifstream in(filename.c_str());
+    if(!in){
+        std::cout << "Error: Cannot open sweep configuration " << filename << std::endl;
+        ::exit(-1);
+    }
+    std::string line;
+    while(std::getline(in, line)){
+        line = line.substr(0, line.find('#'));
+        std::string::size_type eq = line.find('=');
+        if(eq == std::string::npos)
+            continue;
+        std::string name = line.substr(0, eq), value = line.substr(eq+1);
+        name.erase(0, name.find_first_not_of(" \t")); name.erase(name.find_last_not_of(" \t\r")+1);
+        value.erase(0, value.find_first_not_of(" \t")); value.erase(value.find_last_not_of(" \t\r")+1);
+        config[name] = value;
+    }
+    return config;
+}
+
+
+// Runs the Cartesian product of a parameter grid, scheduling one experiment process per core.
+// Each configuration runs in its own forked process pinned to a core, which sends one row per finished repetition
+// back to the parent. The parent appends the rows to the output file as they arrive, so an interrupted sweep can be resumed.
+class SweepRunner {
+    // A child process running one configuration
+    struct Job{
+        pid_t pid;  // The child process, 0 when the slot is free
+        int fd;  // The read end of the pipe from the child
+        uint config;  // The index of the configuration it runs
+        std::string buffer;  // Received data not yet terminated by a newline
+    };
+
+    SweepParams sp;  // The sweep parameters
+    std::vector<Experiment::Params> configs;  // The configurations of the grid
+    std::set<std::string> done;  // The keys of the repetitions already in the output
+    std::ofstream out;  // The output file
+    uint failed;  // The number of configurations whose process failed
+
+public:
+    SweepRunner(const SweepParams & sp)
+    :sp(sp), failed(0)
+    {
+        Expand();
+    }
+
+    // Runs all the configurations with missing repetitions. Returns the number of configurations which failed.
+    uint Run(){
+        OpenOutput();
+
+        std::deque<uint> pending;  // The configurations which still have repetitions to run
+        uint skipped = 0;
+        for(uint c=0; c<configs.size(); ++c){
+            if(RemainingRepetitions(c) > 0) pending.push_back(c);
+            else skipped++;
+        }
+        std::cout << "Sweep: " << configs.size() << " configurations x " << sp.times << " repetitions on "
+            << sp.cores.size() << " cores, " << skipped << " configurations already complete" << std::endl;
+
+        std::vector<Job> jobs(sp.cores.size());
+        foreach(Job & job, jobs) job.pid = 0;
+        uint running = 0;
+
+        while(!pending.empty() || running > 0){
+            // Start configurations on the free cores
+            for(uint j=0; j<jobs.size() && !pending.empty(); ++j){
+                if(jobs[j].pid != 0) continue;
+                Start(jobs[j], sp.cores[j], pending.front());
+                pending.pop_front();
+                running++;
+            }
+
+            // Wait for rows from the running configurations
+            std::vector<struct pollfd> fds;
+            std::vector<uint> fd_jobs;
+            for(uint j=0; j<jobs.size(); ++j){
+                if(jobs[j].pid == 0) continue;
+                struct pollfd pfd = {jobs[j].fd, POLLIN, 0};
+                fds.push_back(pfd);
+                fd_jobs.push_back(j);
+            }
+            if(poll(&fds[0], fds.size(), -1) < 0 && errno != EINTR){
+                std::cout << "Error: poll failed" << std::endl;
+                ::exit(-1);
+            }
+            for(uint i=0; i<fds.size(); ++i){
+                if(fds[i].revents == 0) continue;
+                if(!Receive(jobs[fd_jobs[i]])){  // The child has finished
+                    Finish(jobs[fd_jobs[i]], sp.cores[fd_jobs[i]]);
+                    running--;
+                }
+            }
+        }
+        return failed;
+    }
+
+protected:
+    // Creates the configurations of the grid, numbered from 1.
+    // A replayed trace sets the number of flows, as in the rows its experiments write, so that the keys of a resumed
+    // sweep match them and the flow counts of the grid do not repeat the same configuration.
+    void Expand(){
+        std::vector<uint> flow_counts = sp.flow_counts;
+        if(!sp.trace_file.empty())
+            flow_counts.assign(1, PcapTrace(sp.trace_file).FlowCount());
+        Experiment::Params p;
+        p.validation = sp.validation;
+        p.memory_stats = sp.memory_stats;
+        p.query_mode = sp.query_mode;
+        p.query_interval = sp.query_interval;
+        p.trace_file = sp.trace_file;
+        p.number = 0;
+        foreach(Experiment::AlgorithmType alg_type, sp.alg_types)
+        foreach(uint flow_count, flow_counts)
+        foreach(uint max_queue_size, sp.max_queue_sizes)
+        foreach(uint k_heaviest, sp.k_heaviests)
+        foreach(uint seq_size, sp.seq_sizes)
+        foreach(uint random_seed, sp.random_seeds){
+            p.alg_type = alg_type;
+            p.flow_count = flow_count;
+            p.max_queue_size = max_queue_size;
+            p.k_heaviest = k_heaviest;
+            p.seq_size = seq_size;
+            p.random_seed = random_seed;
+            p.number++;
+            configs.push_back(p);
+        }
+    }
+
+    // Returns the key identifying one repetition of a configuration
+    static std::string Key(const std::vector<std::string> & names, const std::vector<std::string> & values, const std::string & repetition){
+        std::vector<std::string> keys = ResultWriter::KeyFields();
+        std::string key = repetition;
+        foreach(const std::string & k, keys){
+            std::vector<std::string>::const_iterator it = std::find(names.begin(), names.end(), k);
+            key += "|" + ((it == names.end()) ? std::string() : values[it - names.begin()]);
+        }
+        return key;
+    }
+
+    std::string Key(uint config, uint repetition){
+        std::ostringstream dummy;
+        ResultWriter writer(dummy, sp.format);
+        writer.BuildRow(ResultRow(configs[config], repetition));
+        std::ostringstream rep;
+        rep << repetition;
+        return Key(writer.Names(), writer.Values(), rep.str());
+    }
+
+    uint RemainingRepetitions(uint config){
+        uint remaining = 0;
+        for(uint r=1; r<=sp.times; ++r)
+            if(done.count(Key(config, r)) == 0) remaining++;
+        return remaining;
+    }
+
+    // Opens the output file. When resuming, loads the keys of the rows already in it and appends to it.
+    void OpenOutput(){
+        bool has_rows = false, ends_with_newline = true;
+        if(sp.resume){
+            std::ifstream in(sp.output_file.c_str());
+            std::string line;
+            std::vector<std::string> header;
+            while(std::getline(in, line)){
+                ends_with_newline = !in.eof();
+                std::vector<std::string> names, values;
+                if(sp.format == Experiment::CSV){
+                    if(header.empty()){ header = SplitCsv(line); continue; }
+                    values = SplitCsv(line);
+                    if(values.size() != header.size()) continue;  // Incomplete row, e.g. from an interrupted sweep
+                    names = header;
+                }else if(!ParseJsonLine(line, names, values))
+                    continue;
+                std::vector<std::string>::iterator rep = std::find(names.begin(), names.end(), std::string("repetition"));
+                if(rep == names.end()) continue;
+                done.insert(Key(names, values, values[rep - names.begin()]));
+                has_rows = true;
+            }
+            has_rows = has_rows || !header.empty();
+        }
+
+        out.open(sp.output_file.c_str(), (sp.resume && has_rows) ? std::ios::app : std::ios::trunc);
+        if(!out){
+            std::cout << "Error: Cannot open sweep output " << sp.output_file << std::endl;
+            ::exit(-1);
+        }
+        if(!ends_with_newline)
+            out << std::endl;  // Terminate a row cut short by an interruption
+        if(!(sp.resume && has_rows))
+            ResultWriter(out, sp.format).Header();
+    }
+
+    // Forks a process running the missing repetitions of a configuration on a core
+    void Start(Job & job, uint core, uint config){
+        int fds[2];
+        if(pipe(fds) != 0){
+            std::cout << "Error: pipe failed" << std::endl;
+            ::exit(-1);
+        }
+        std::cout.flush();
+        pid_t pid = fork();
+        if(pid < 0){
+            std::cout << "Error: fork failed" << std::endl;
+            ::exit(-1);
+        }
+        if(pid == 0){  // The child
+            close(fds[0]);
+            prctl(PR_SET_PDEATHSIG, SIGTERM);  // Do not outlive an interrupted sweep
+            if(!PinToCore(core))
+                std::cout << "Warning: Cannot pin to core " << core << std::endl;
+            RunConfig(config, fds[1]);
+            close(fds[1]);
+            _exit(0);
+        }
+        close(fds[1]);
+        job.pid = pid;
+        job.fd = fds[0];
+        job.config = config;
+        job.buffer.clear();
+    }
+
+    // Runs the missing repetitions of a configuration, writing one row per repetition to fd (in the child)
+    void RunConfig(uint config, int fd){
+        Experiment::Params params = configs[config];
+        double baseline = (params.alg_type != Experiment::NOPROCESSING) ? Experiment::MeasureBaseline(params, sp.times) : 0.0;
+        Experiment * reused = NULL;  // The experiment of the previous repetition, if it could be reset, as in RunExperiment()
+        for(uint r=1; r<=sp.times; ++r){
+            if(done.count(Key(config, r)) != 0)
+                continue;
+            if(reused == NULL)
+                reused = new Experiment(params);  // Create the experiment
+            Experiment & exp = *reused;
+            OneShotTimer timer;
+            timer.Start();  // Start timing
+            exp.UniformExperiment();  // Run experiment
+            timer.Stop();  // Stop timing
+            Experiment::Params ran = exp.GetParams();
+            uint packets = exp.GetPacketCount();
+            AllocationStats memory = exp.GetCurrentAlgorithm()->MemoryStats();
+            LatencyRecorder latency = exp.GetQueryLatency();
+            AccuracyStats accuracy = exp.GetAccuracy();
+            if(!exp.Reset()){  // Construct the next one anew
+                delete reused;
+                reused = NULL;
+            }
+            ResultRow result(ran, r, timer.Duration(), packets, baseline, memory);
+            result.latency = latency;
+            result.accuracy = accuracy;
+            std::ostringstream row;
+            ResultWriter(row, sp.format).Row(result);
+            std::string s = row.str();
+            for(std::size_t written = 0; written < s.size(); ){
+                ssize_t n = write(fd, s.data() + written, s.size() - written);
+                if(n <= 0) _exit(1);
+                written += n;
+            }
+        }
+        delete reused;
+    }
+
+    // Reads the rows a child has sent and appends them to the output. Returns false when the child has closed its pipe.
+    bool Receive(Job & job){
+        char buf[4096];
+        ssize_t n = read(job.fd, buf, sizeof(buf));
+        if(n < 0 && errno == EINTR)
+            return true;
+        if(n <= 0)
+            return false;
+        job.buffer.append(buf, n);
+        std::string::size_type nl = job.buffer.rfind('\n');
+        if(nl != std::string::npos){
+            out << job.buffer.substr(0, nl+1);
+            out.flush();  // Every finished repetition is durable before the next one is reported
+            job.buffer.erase(0, nl+1);
+        }
+        return true;
+    }
+
+    // Collects a finished child and reports the configuration's status
+    void Finish(Job & job, uint core){
+        close(job.fd);
+        int status = 0;
+        waitpid(job.pid, &status, 0);
+        Experiment::Params & p = configs[job.config];
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if(!ok) failed++;
+        std::cout << (ok ? "Done: " : "Failed: ") << p << ", Core:" << core << std::endl;
+        job.pid = 0;
+    }
+
+    // Splits a CSV line into its (unquoted) fields
+    static std::vector<std::string> SplitCsv(const std::string & line){
+        std::vector<std::string> fields(1);
+        bool in_quotes = false;
+        for(std::string::size_type i=0; i<line.size(); ++i){
+            char c = line[i];
+            if(in_quotes){
+                if(c == '"' && i+1 < line.size() && line[i+1] == '"'){ fields.back() += '"'; ++i; }
+                else if(c == '"') in_quotes = false;
+                else fields.back() += c;
+            }else if(c == '"') in_quotes = true;
+            else if(c == ',') fields.push_back(std::string());
+            else if(c != '\r') fields.back() += c;
+        }
+        return fields;
+    }
+
+    // Parses a flat JSON object of string and number values, as written by ResultWriter
+    static bool ParseJsonLine(const std::string & line, std::vector<std::string> & names, std::vector<std::string> & values){
+        std::string::size_type i = line.find('{');
+        if(i == std::string::npos || line.find('}') == std::string::npos)
+            return false;
+        ++i;
+        while(true){
+            std::string name, value;
+            i = line.find('"', i);
+            if(i == std::string::npos) break;
+            if(!ReadJsonString(line, i, name)) return false;
+            i = line.find(':', i);
+            if(i == std::string::npos) return false;
+            i = line.find_first_not_of(" \t", i+1);
+            if(i == std::string::npos) return false;
+            if(line[i] == '"'){
+                if(!ReadJsonString(line, i, value)) return false;
+            }else{
+                std::string::size_type e = line.find_first_of(",}", i);
+                if(e == std::string::npos) return false;
+                value = line.substr(i, e - i);
+                value.erase(value.find_last_not_of(" \t")+1);
+                i = e;
+            }
+            names.push_back(name);
+            values.push_back(value);
+            i = line.find_first_of(",}", i);
+            if(i == std::string::npos || line[i] == '}') break;
+        }
+        return !names.empty();
+    }
+
+    // Reads a JSON string starting at the quote at i, leaves i after the closing quote
+    static bool ReadJsonString(const std::string & line, std::string::size_type & i, std::string & s){
+        for(++i; i<line.size(); ++i){
+            if(line[i] == '\\' && i+1 < line.size()){
+                ++i;
+                s += (line[i] == 'n') ? '\n' : line[i];
+            }else if(line[i] == '"'){
+                ++i;
+                return true;
+            }else
+                s += line[i];
+        }
+        return false;
+    }
+};
+
+#endif /* SWEEP_H_ */
@@ -0,0 +1,250 @@
+/*
+TeeExperiment.h
+
+Copyright 2011 Remous-Aris Koutsiamanis
+
+This file is part of HL-Hitters.
+
+HL-Hitters is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+HL-Hitters is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEEEXPERIMENT_H_
+#define TEEEXPERIMENT_H_
+
+#include "Common.h"
+#include "Experiment.h"
+
+// An Experiment which generates each packet once and feeds the same stream to several algorithms (Params::tee).
+// The queue is shared: its operations are collected into slices of Params::tee_slice operations, and each algorithm in turn
+// runs a whole slice, with its queries, under its own timer. A slice of 1 is round-robin per operation; longer slices let each
+// algorithm run with its own data in the caches and make the timer overhead negligible. The first algorithm of a slice rotates,
+// so none always runs after the same one. After each slice the exact algorithms are cross-checked, outside the timers.
+class TeeExperiment : public Experiment {
+protected:
+    // An operation on the shared queue
+    struct TeeOp{
+        Packet packet;
+        bool append;  // Whether the packet was appended, otherwise it was served
+        bool query;  // Whether the algorithms query the heaviest hitters after it
+
+        TeeOp(const Packet & packet, bool append, bool query)
+        :packet(packet), append(append), query(query) {}
+    };
+
+    // An algorithm fed by the tee
+    struct Member{
+        AlgorithmType type;
+        Algorithm * algorithm;
+        uint64_t ns;  // The time spent in the algorithm
+        HittersQueryResult results;  // The results of its queries, kept at class level to amortize allocation costs
+    };
+
+    std::vector<Member> members;
+    std::vector<TeeOp> slice;  // The operations not yet run by the algorithms
+    uint first;  // The member which runs the next slice first
+    Member * reference;  // The first exact algorithm, which the other exact algorithms are checked against, NULL if none
+    HittersQueryResult checked_results;  // Used in CrossCheck(), kept at class level to amortize allocation costs
+
+public:
+    // Constructor, the algorithms are Params::tee and the base experiment runs no algorithm of its own
+    TeeExperiment(Params p)
+    :Experiment(BaseParams(p)), first(0), reference(NULL)
+    {
+        params.tee = p.tee;
+        members.resize(params.tee.size());
+        for(uint i=0; i<members.size(); ++i){
+            members[i].type = params.tee[i];
+            members[i].algorithm = CreateAlgorithm(params.tee[i], params.max_queue_size, params.memory_stats, params,
+                                                   params.huge_pages ? &algorithm_arena : NULL);
+            members[i].ns = 0;
+            members[i].results.reserve(params.k_heaviest);
+            if(reference == NULL && members[i].type != NOPROCESSING && members[i].algorithm->IsExact())
+                reference = &members[i];
+        }
+        slice.reserve(params.tee_slice);
+        checked_results.reserve(params.k_heaviest);
+    }
+
+    ~TeeExperiment(){
+        foreach(Member & m, members)
+            delete m.algorithm;
+    }
+
+    // Runs the experiment from start to finish, with the same phases as UniformExperiment()
+    void TeeRun(){
+        while( queue.size() < queue.max_queue_size && iteration < params.seq_size )
+            TeeAppend();
+        while( iteration + queue.max_queue_size < params.seq_size ){
+            if(queue.size() >= queue.max_queue_size)
+                TeeRemove();
+            TeeAppend();
+        }
+        while( queue.size() > 0 )
+            TeeRemove();
+        RunSlice();
+    }
+
+    // Returns the number of algorithms
+    uint Members(){
+        return members.size();
+    }
+
+    // Returns the time spent in an algorithm in seconds
+    double MemberSeconds(uint i){
+        return members[i].ns / 1e9;
+    }
+
+    // Returns an algorithm
+    Algorithm * MemberAlgorithm(uint i){
+        return members[i].algorithm;
+    }
+
+    // Helper function for executing a tee experiment multiple times and collecting the statistics of each algorithm
+    static void RunTee(Experiment::Params params, uint times);
+
+protected:
+    // The parameters of the base experiment, which only generates and queues the packets
+    static Params BaseParams(Params p){
+        p.alg_type = NOPROCESSING;
+        p.validation = false;
+        p.notify = false;
+        p.check = false;
+        p.oplog_file.clear();
+        p.checkpoint_file.clear();
+        p.restore_file.clear();
+        return p;
+    }
+
+    // Appends a new packet to the shared queue
+    void TeeAppend(){
+        ++iteration;
+        ++packets;
+        Packet packet_in = NextPacket();
+        queue.push_back(packet_in);
+        bool query = (params.query_mode == QUERY_PACKET) || (params.query_mode == QUERY_EVERY && packets % params.query_interval == 0);
+        Add(TeeOp(packet_in, true, query));
+    }
+
+    // Serves a packet from the shared queue
+    void TeeRemove(){
+        ++iteration;
+        Packet packet_out = queue.front();
+        queue.pop_front();
+        Add(TeeOp(packet_out, false, false));
+    }
+
+    // Adds an operation to the slice, and runs the slice once it is full
+    void Add(const TeeOp & op){
+        slice.push_back(op);
+        if(slice.size() >= params.tee_slice)
+            RunSlice();
+    }
+
+    // Runs the slice on every algorithm, each under its own timer, and cross-checks them
+    void RunSlice(){
+        if(slice.empty())
+            return;
+        for(uint n=0; n<members.size(); ++n){
+            Member & m = members[(first + n) % members.size()];
+            uint64_t start = LatencyRecorder::Now();
+            foreach(TeeOp & op, slice){
+                if(op.append)
+                    m.algorithm->Append(op.packet);
+                else
+                    m.algorithm->Expire(op.packet);
+                if(op.query){
+                    m.results.clear();
+                    m.algorithm->QueryHeaviest(params.k_heaviest, m.results);
+                }
+            }
+            m.ns += LatencyRecorder::Now() - start;
+        }
+        first = (first + 1) % members.size();
+        slice.clear();
+        CrossCheck();
+    }
+
+    // Checks the exact algorithms against the reference: the same total count, and top-k's with the counts of the reference's
+    // top-k whose flows have the same counts in the reference, so flows tied with the k-th may differ
+    void CrossCheck(){
+        if(reference == NULL)
+            return;
+        Algorithm * valid = reference->algorithm;
+        HittersQueryResult & valid_results = reference->results;
+        valid_results.clear();
+        valid->QueryHeaviest(params.k_heaviest, valid_results);
+        foreach(Member & m, members){
+            if(&m == reference || m.type == NOPROCESSING || !m.algorithm->IsExact())
+                continue;
+            checked_results.clear();
+            m.algorithm->QueryHeaviest(params.k_heaviest, checked_results);
+            bool same = (checked_results.size() == valid_results.size()) && m.algorithm->TotalCount() == valid->TotalCount();
+            for(uint i=0; same && i<checked_results.size(); ++i)
+                same = checked_results[i].second == valid_results[i].second && valid->GetCount(checked_results[i].first) == checked_results[i].second;
+            if(!same){
+                std::cout << "At iteration " << iteration << " the results of " << AlgTypeStr(m.type) << " differ from those of "
+                          << AlgTypeStr(reference->type) << "!" << std::endl;
+                std::cout << AlgTypeStr(reference->type) << " Results :" << valid_results << std::endl;
+                std::cout << AlgTypeStr(m.type) << " Results :" << checked_results << std::endl;
+                ::exit(-1);
+            }
+        }
+    }
+};
+
+// Helper function for executing a tee experiment multiple times and collecting the statistics of each algorithm
+void TeeExperiment::RunTee(Experiment::Params params, uint times){
+    std::vector<MultiShotTimer> timers(params.tee.size());  // The time spent in each algorithm
+    MultiShotTimer total;  // The time of the whole experiment, including the packet generation and queueing
+    std::vector<AllocationStats> memory(params.tee.size());  // The memory usage of each algorithm, identical in every repetition
+    Experiment::Params ran = params;
+    uint packets = 0;
+    for(uint i = 0; i < times; i++){
+        TeeExperiment exp(params);
+        total.Start();
+        exp.TeeRun();
+        total.Stop();
+        ran = exp.GetParams();
+        packets = exp.GetPacketCount();
+        for(uint m=0; m<exp.Members(); ++m){
+            timers[m].Add(exp.MemberSeconds(m));
+            memory[m] = exp.MemberAlgorithm(m)->MemoryStats();
+        }
+    }
+
+    // Print the results of each algorithm as if it had run alone, its time is net of the packet generation and queueing
+    static bool header_written = false;
+    ResultWriter writer(std::cout, params.output_format);
+    if(params.output_format != TEXT && !header_written){
+        writer.Header();
+        header_written = true;
+    }
+    for(uint m=0; m<params.tee.size(); ++m){
+        ran.alg_type = params.tee[m];
+        if(params.output_format == TEXT){
+            std::cout << "Ran as: " << ran << ", Execution Time Statistics: " << timers[m];
+            if(params.memory_stats)
+                std::cout << ", Memory Statistics: " << memory[m];
+            std::cout << ", TeeTotalSeconds:" << total.Mean() << std::endl;
+            continue;
+        }
+        for(uint i = 0; i < times; i++){
+            ResultRow row(ran, i+1, timers[m].Duration(i), packets, 0.0, memory[m]);
+            row.tee_total_seconds = total.Duration(i);
+            writer.Row(row);
+        }
+    }
+}
+
+#endif /* TEEEXPERIMENT_H_ */
@@ -24,6 +24,9 @@ along with HL-Hitters.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Common.h"
 
+#include <time.h>  // For clock_gettime()
+#include <stdint.h>
+
 // Implements a timer which can count the duration of one event
 class OneShotTimer{
     boost::posix_time::ptime requestStart, requestEnd;
@@ -61,11 +64,21 @@ public:
         durations.push_back(timer.Duration());
     }
 
+    // Records the duration of an event timed elsewhere
+    void Add(double duration){
+        durations.push_back(duration);
+    }
+
     // Returns the number of timings made
     uint Count(){
         return durations.size();
     }
 
+    // Returns the duration of the i-th timing
+    double Duration(uint i){
+        return durations[i];
+    }
+
     // Returns the sum of the timings
     double Sum(){
         double sum=0.0;
@@ -110,4 +123,123 @@ std::ostream& operator<< (std::ostream &out, MultiShotTimer &mst){
     return out;
 }
 
+
+// Records the latencies of many short events (e.g. queries) in nanoseconds, without allocating.
+// Latencies are kept in a log-linear histogram (8 linear sub-buckets per power of 2), so quantiles are within 12.5%.
+class LatencyRecorder{
+    static const uint sub_buckets = 8;  // The number of linear sub-buckets per power of 2
+    static const uint buckets = 64 * sub_buckets;  // Covers the whole uint64_t range
+
+    uint64_t histogram[buckets];  // The number of latencies in each bucket
+    uint64_t count;  // The number of latencies
+    double sum;  // The sum of the latencies
+    uint64_t max;  // The maximum latency
+
+public:
+    LatencyRecorder(){
+        Clear();
+    }
+
+    // Returns the current time of the monotonic clock in nanoseconds
+    static uint64_t Now(){
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    // Forgets all the recorded latencies
+    void Clear(){
+        std::fill(histogram, histogram + buckets, 0);
+        count = 0;
+        sum = 0.0;
+        max = 0;
+    }
+
+    // Records one latency
+    void Record(uint64_t ns){
+        histogram[Bucket(ns)]++;
+        count++;
+        sum += ns;
+        if(ns > max) max = ns;
+    }
+
+    // Returns the number of recorded latencies
+    uint64_t Count() const {
+        return count;
+    }
+
+    // Returns the mean latency
+    double Mean() const {
+        return count ? sum / count : 0.0;
+    }
+
+    // Returns the maximum latency
+    uint64_t Max() const {
+        return max;
+    }
+
+    // Returns the q quantile of the latencies, as the upper bound of its bucket (but at most the maximum)
+    uint64_t Quantile(double q) const {
+        if(count == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(q * count);
+        if(rank >= count) rank = count - 1;
+        uint64_t seen = 0;
+        for(uint b=0; b<buckets; ++b){
+            seen += histogram[b];
+            if(seen > rank)
+                return std::min(BucketUpperBound(b), max);
+        }
+        return max;
+    }
+
+protected:
+    // Returns the bucket of a latency: values under sub_buckets have their own buckets,
+    // larger ones are split by their highest set bit and the next 3 bits
+    static uint Bucket(uint64_t ns){
+        if(ns < sub_buckets)
+            return (uint)ns;
+        uint log2 = 63 - __builtin_clzll(ns);
+        return (log2 - 2) * sub_buckets + (uint)((ns >> (log2 - 3)) & (sub_buckets - 1));
+    }
+
+    // Returns the largest latency of a bucket
+    static uint64_t BucketUpperBound(uint b){
+        if(b < sub_buckets)
+            return b;
+        uint log2 = b / sub_buckets + 2;
+        uint64_t lower = ((uint64_t)(sub_buckets + b % sub_buckets)) << (log2 - 3);
+        return lower + (1ULL << (log2 - 3)) - 1;
+    }
+};
+
+// Helper function for printing
+std::ostream& operator<< (std::ostream &out, const LatencyRecorder &lr){
+    out << "Count:" << lr.Count() << ", Mean(ns):" << lr.Mean() << ", P50(ns):" << lr.Quantile(0.5)
+        << ", P99(ns):" << lr.Quantile(0.99) << ", P999(ns):" << lr.Quantile(0.999) << ", Max(ns):" << lr.Max();
+    return out;
+}
+
+
+// The measurements of one stage of a PipelineExperiment
+struct StageStats{
+    uint64_t items;  // The number of items the stage produced
+    uint64_t start_ns, end_ns;  // When the stage started and finished
+    uint64_t stalls;  // The number of waits for room on the full output ring (backpressure)
+    uint64_t starves;  // The number of waits for items on the empty input ring
+
+    StageStats()
+    :items(0), start_ns(0), end_ns(0), stalls(0), starves(0) {}
+
+    double Seconds() const { return (end_ns - start_ns) / 1e9; }
+    double ItemsPerSecond() const { return (end_ns > start_ns) ? items / Seconds() : 0.0; }
+};
+
+// Helper function for printing
+std::ostream& operator<< (std::ostream &out, const StageStats &s){
+    out << "Items:" << s.items << ", Seconds:" << s.Seconds() << ", ItemsPerSec:" << s.ItemsPerSecond()
+        << ", Stalls:" << s.stalls << ", Starves:" << s.starves;
+    return out;
+}
+
 #endif /* TIMER_H_ */